@@ -0,0 +1,106 @@
+//
+// BKBloomFilter.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Blocked Bloom filter of tokens.
+ 
+ The bits are split in blocks of 512 bits, the size of a cache line: a token 
+ selects one block and sets 7 bits within it, so a lookup touches a single 
+ cache line. A filter sized for its capacity keeps about 10 bits per token, 
+ which gives less than 2% of false positives. There is never any false negative.
+ 
+ You should never have to handle an object of this class directly.
+ */
+@interface BKBloomFilter : NSObject {
+    @private
+    uint64_t *_blocks;
+    NSUInteger _blocksCount;
+    NSUInteger _count;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Properties
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Number of tokens added to the filter, duplicates included. */
+@property (readonly, getter=count) NSUInteger _count;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Initializing a filter
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Initialize an empty filter.
+ 
+ @param capacity The number of distinct tokens expected. Adding more only raises 
+ the false positives rate.
+ @return An initialized filter.
+ */
+- (id)initWithCapacity:(NSUInteger)capacity;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Handling tokens
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Add a token to the filter.
+ 
+ @param token The token to add.
+ */
+- (void)addToken:(NSString*)token;
+
+/** Returns whether a token may have been added to the filter.
+ 
+ @param token The token to look for.
+ @return NO if the token was certainly never added, YES otherwise.
+ */
+- (BOOL)mayContainToken:(NSString*)token;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Print statistics
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the memory used by the filter's bits. */
+- (NSUInteger)sizeInBytes;
+
+/** Print some basics statistics on the receiver */
+- (void)printInformations;
+
+@end
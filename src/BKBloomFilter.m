@@ -0,0 +1,125 @@
+//
+// BKBloomFilter.m
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <BayesianKit/BKBloomFilter.h>
+#import "BKHashing.h"
+
+#define BKBloomBlockWords 8
+#define BKBloomBitsPerToken 10
+#define BKBloomProbesCount 7
+
+
+@implementation BKBloomFilter
+
+@synthesize _count;
+
+- (id)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        uint64_t bits = (uint64_t)MAX(capacity, 1u) * BKBloomBitsPerToken;
+        _blocksCount = (NSUInteger)((bits + 511) / 512);
+        
+        size_t size = _blocksCount * BKBloomBlockWords * sizeof(uint64_t);
+        void *blocks = NULL;
+        if (posix_memalign(&blocks, 64, size) != 0) {
+            [self release];
+            @throw [NSException exceptionWithName:NSMallocException 
+                                           reason:@"Unable to allocate the filter's blocks" 
+                                         userInfo:nil];
+        }
+        _blocks = memset(blocks, 0, size);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_blocks);
+    [super dealloc];
+}
+
+- (void)finalize
+{
+    free(_blocks);
+    [super finalize];
+}
+
+#pragma mark -
+#pragma mark Tokens Methods
+- (void)addToken:(NSString*)token
+{
+    uint64_t hash = BKMixHash([token hash]);
+    uint64_t *block = _blocks + ((hash >> 32) * _blocksCount >> 32) * BKBloomBlockWords;
+    
+    hash = BKMixHash(hash ^ 0x9e3779b97f4a7c15ULL);
+    for (NSUInteger probe = 0; probe < BKBloomProbesCount; probe++) {
+        block[(hash >> 6) & 7] |= 1ULL << (hash & 63);
+        hash >>= 9;
+    }
+    _count++;
+}
+
+- (BOOL)mayContainToken:(NSString*)token
+{
+    uint64_t hash = BKMixHash([token hash]);
+    const uint64_t *block = _blocks + ((hash >> 32) * _blocksCount >> 32) * BKBloomBlockWords;
+    
+    hash = BKMixHash(hash ^ 0x9e3779b97f4a7c15ULL);
+    for (NSUInteger probe = 0; probe < BKBloomProbesCount; probe++) {
+        if ((block[(hash >> 6) & 7] & (1ULL << (hash & 63))) == 0) return NO;
+        hash >>= 9;
+    }
+    return YES;
+}
+
+#pragma mark -
+#pragma mark Printing Methods
+- (NSUInteger)sizeInBytes
+{
+    return _blocksCount * BKBloomBlockWords * sizeof(uint64_t);
+}
+
+- (void)printInformations
+{
+    NSLog(@"Bloom Filter Informations:");
+    NSLog(@"         Number of tokens: %llu", (unsigned long long)_count);
+    NSLog(@"         Number of blocks: %llu", (unsigned long long)_blocksCount);
+    NSLog(@"             Size (bytes): %llu", (unsigned long long)[self sizeInBytes]);
+}
+
+@end
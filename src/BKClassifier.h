@@ -38,6 +38,10 @@
 #import <Foundation/Foundation.h>
 
 #import <BayesianKit/BKDataPool.h>
+#import <BayesianKit/BKBloomFilter.h>
+#import <BayesianKit/BKCompactModel.h>
+#import <BayesianKit/BKFrozenModel.h>
+#import <BayesianKit/BKResultCache.h>
 #import <BayesianKit/BKTokenizing.h>
 
 
@@ -58,16 +62,90 @@
  
  Once trained the classifier can be immediatly used with @c guessWithFile:() or
  @c guessWithString:(). Both returns a dictionary containing the score, in 
- percent for each pool.
+ percent for each pool. The @c inPools: variants only score the pools asked for.
+ 
+ Setting @c resultCacheCapacity enables a cache of guesses' results, so that 
+ repeated, or near-duplicate, documents are not scored twice. Training, 
+ stripping, removing pools or changing the combiner invalidates it. Changes made
+ directly to a pool through @c pools are not tracked by the cache.
+ 
+ Saved files hold each pool in a section of its own. They are mapped rather than
+ read, and pools are only paged in, decoded, and their probabilities computed, 
+ the first time they are needed. Pools never used cost neither memory, decoding
+ nor probabilities computation.
+ 
+ The corpus, every token's count over all the pools, is not kept up to date: 
+ training only counts the token in its pool, and the corpus is derived when 
+ probabilities are rebuilt. Saved files hold, in a section of their own, the 
+ corpus of the pools they were written with. A rebuild only decodes that 
+ section and, again, the saved sections of the pools decoded or removed since, 
+ to swap their saved counts for their current ones. Pools never decoded are 
+ still never touched, after training or applying deltas too. 
+ Classifiers without a saved corpus, such as ones read from older files or 
+ from a plain keyed archive, decode every pool for a rebuild.
+ 
+ @c writeToFile:() also brings every decoded pool's probabilities up to date 
+ first and records them as such, so that guesses on a saved file only decode 
+ the pools they score and rebuild none of them.
+ 
+ Along with the probabilities, a Bloom filter of the tokens holding one is 
+ built, so that guesses discard the tokens unknown to every pool without 
+ looking them up. The filter is not saved: a loaded classifier sizes it from 
+ the vocabulary saved in the file's header, and adds the tokens of each pool 
+ saved up to date as it is decoded for a guess.
+ 
+ Every document is processed within its own autorelease pool, so bulk training 
+ with @c trainWithFiles:forPoolNamed:() keeps a flat memory footprint whatever 
+ the number of files. Guesses gather probabilities into buffers of their own 
+ rather than into the classifier or its compact and frozen models, call the 
+ combiner without writing its invocation, and the result cache locks itself. 
+ Several threads can therefore guess at once on a compact or frozen classifier, 
+ or once every pool is decoded, by accessing @c pools, and brought up to date 
+ by @c updatePoolsProbabilities(). Guesses which have to decode pools, rebuild 
+ probabilities or fill the filter change the classifier and must not run 
+ concurrently.
  
  To avoid unecessary big pools, @c stripToLevel:() will remove any token with a 
  total count lower than specified.
+ 
+ Every training, stripping or pool removal starts a new @c generation. Saving
+ the classifier records a checkpoint of its generation and checksum, from which 
+ @c deltaSinceGeneration:() exports only the counts changed since. Replicas 
+ holding that checkpoint's model catch up with @c applyDelta:() instead of 
+ reloading the whole file. Removed tokens are remembered for the deltas only 
+ when a checkpoint holds them, and until @c discardChangesBeforeGeneration:() 
+ forgets the checkpoints no replica is at anymore.
+ 
+ For memory constrained deployments, @c compactWithQuantizationBits:() turns the 
+ classifier into a read-only compact model. Use 
+ @c compareWithClassifier:onFiles:() to measure what the quantization costs.
+ Deployed replicas which only guess can be turned with @c freeze() into a 
+ read-only model keeping full precision probabilities behind a perfect hash.
  */
 @interface BKClassifier : NSObject <NSCoding> {
-    BKDataPool *corpus;
-    
     NSMutableDictionary *pools;
-    BOOL dirty;
+    NSMutableDictionary *archivedPools;
+    NSDictionary *poolsSections;
+    NSArray *corpusSection;
+    NSData *mappedFile;
+    NSData *savedCorpus;
+    NSDictionary *savedPools;
+    NSMutableSet *cachedPools;
+    BKBloomFilter *significantTokens;
+    NSMutableSet *significantPools;
+    NSUInteger vocabularyCount;
+    
+    NSUInteger generation;
+    uint64_t checksum;
+    BOOL checksumOutdated;
+    NSMutableDictionary *checkpoints;
+    NSMutableDictionary *removedPools;
+    
+    BKCompactModel *compactModel;
+    BKFrozenModel *frozenModel;
+    
+    BKResultCache *resultCache;
+    NSUInteger resultCacheMaximumDistance;
     
     NSInvocation *probabilitiesCombinerInvocation;
     
@@ -78,7 +156,11 @@
 /// @name Properties
 //////////////////////////////////////////////////////////////////////////////////////////
 
-/** Dictionary containing every data pools of the classifier */
+/** Dictionary containing every data pools of the classifier 
+ 
+ Accessing this property loads every pool not yet decoded, use @c poolNames() 
+ when only the names are needed.
+ */
 @property (readonly) NSMutableDictionary *pools;
 
 /** Invocation to call for combining probabilities.
@@ -95,6 +177,37 @@
  */
 @property (readwrite, retain) id<BKTokenizing> tokenizer;
 
+/** YES if the classifier was turned into a compact model.
+ 
+ @see compactWithQuantizationBits:
+ */
+@property (readonly, getter=isCompact) BOOL compact;
+
+/** YES if the classifier was frozen.
+ 
+ @see freeze
+ */
+@property (readonly, getter=isFrozen) BOOL frozen;
+
+/** Maximum number of guesses' results kept in cache.
+ 
+ 0, the default, disables the cache. Changing it empties the cache.
+ */
+@property (readwrite, assign) NSUInteger resultCacheCapacity;
+
+/** Maximum number of differing SimHash bits for a near-duplicate document to 
+ reuse a cached result.
+ 
+ 0, the default, only reuses results of identical groups of tokens.
+ */
+@property (readwrite, assign) NSUInteger resultCacheMaximumDistance;
+
+/** The result cache, nil when disabled. Holds the hit-rate statistics. */
+@property (readonly) BKResultCache *resultCache;
+
+/** Number of changes made to the classifier since its creation. */
+@property (readonly) NSUInteger generation;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Creating a classifier
@@ -128,6 +241,8 @@
 
 /** Saves all training data in a file.
  
+ The file is written aside then renamed, so classifiers mapping the previous file
+ at that path keep reading it safely.
  If path contains a tilde (~) character, you must expand it before invoking this method.
  @param path The path at which to write the file.
  @return YES if the file is written successfully, otherwise NO.
@@ -147,8 +262,16 @@
  */
 - (BKDataPool*)poolNamed:(NSString*)poolName;
 
+/** Returns the names of every pools, decoded or not.
+ 
+ @return An array containing the pools' names.
+ */
+- (NSArray*)poolNames;
+
 /** Destroy a pool with a given name.
  
+ Its counts leave the corpus, so every pool's probabilities are recomputed the 
+ next time they are needed.
  @param poolName The name of the pool.
  */
 - (void)removePoolNamed:(NSString*)poolName;
@@ -161,6 +284,15 @@
 /** Compute the probability associated with every tokens in every pools. */
 - (void)updatePoolsProbabilities;
 
+/** Compute the probability associated with every tokens in some pools.
+ 
+ Only pools whose probabilities are out of date are computed. Decoded pools 
+ which were saved up to date only have their tokens added to the filter of 
+ significant tokens. Unknown pools' names are ignored.
+ @param poolNames The names of the pools to update.
+ */
+- (void)updateProbabilitiesOfPoolsNamed:(NSArray*)poolNames;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Probabilities combining
@@ -215,6 +347,15 @@
  */
 - (void)trainWithFile:(NSString*)path forPoolNamed:(NSString*)poolName;
 
+/** Train the classifier on a group of files.
+ 
+ Each file is processed within its own autorelease pool.
+ @param paths The paths to the files on which the classifier will train.
+ @param poolName The name of the pool to which the content of the files belongs.
+ @see trainWithFile:forPoolNamed:
+ */
+- (void)trainWithFiles:(NSArray*)paths forPoolNamed:(NSString*)poolName;
+
 /** Train the classifier on a string.
  
  @param trainString The string on which the classifier will train.
@@ -248,6 +389,16 @@
  */
 - (NSDictionary*)guessWithFile:(NSString*)path;
 
+/** Ask the classifier to guess on a file, against some pools only.
+ 
+ @param path The path to the file on which the classifier will make a guess.
+ @param poolNames The names of the pools to score, nil meaning every pools.
+ @return A dictionary with the pools' names as keys and theirs probability to 
+ be associated with the file's content.
+ @see guessWithTokens:inPools:
+ */
+- (NSDictionary*)guessWithFile:(NSString*)path inPools:(NSArray*)poolNames;
+
 /** Ask the classifier to guess on a string.
  
  @param string The string on which the classifier will make a guess.
@@ -258,6 +409,16 @@
  */
 - (NSDictionary*)guessWithString:(NSString*)string;
 
+/** Ask the classifier to guess on a string, against some pools only.
+ 
+ @param string The string on which the classifier will make a guess.
+ @param poolNames The names of the pools to score, nil meaning every pools.
+ @return A dictionary with the pools' names as keys and theirs probability to 
+ be associated with the string.
+ @see guessWithTokens:inPools:
+ */
+- (NSDictionary*)guessWithString:(NSString*)string inPools:(NSArray*)poolNames;
+
 /** Ask the classifier to guess on a group of tokens.
  
  @param tokens Tokens on which the classifier will make a guess.
@@ -268,6 +429,18 @@
  */
 - (NSDictionary*)guessWithTokens:(NSArray*)tokens;
 
+/** Ask the classifier to guess on a group of tokens, against some pools only.
+ 
+ Only the pools asked for are decoded and have their probabilities computed.
+ Unknown pools' names are ignored.
+ @param tokens Tokens on which the classifier will make a guess.
+ @param poolNames The names of the pools to score, nil meaning every pools.
+ @return A dictionary with the pools' names as keys and theirs probability to 
+ be associated with those tokens.
+ @see guessWithTokens:
+ */
+- (NSDictionary*)guessWithTokens:(NSArray*)tokens inPools:(NSArray*)poolNames;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Optimizing the classifier
@@ -280,6 +453,90 @@
 - (void)stripToLevel:(NSUInteger)level;
 
 
+/** Turn the classifier into a read-only compact model.
+ 
+ Probabilities are quantized in log-odds space and every pool is merged into a
+ single front coded table, see @c BKCompactModel. Once compacted the classifier
+ can still guess and be saved, but any attempt to train it or to strip it will
+ raise an exception.
+ @param bits The number of bits used to quantize probabilities, either 8 or 16.
+ @exception NSInvalidArgumentException if bits is neither 8 nor 16.
+ */
+- (void)compactWithQuantizationBits:(NSUInteger)bits;
+
+/** Turn the classifier into a read-only frozen model.
+ 
+ Only the probabilities are kept, in a dense row per token indexed by a minimal
+ perfect hash, see @c BKFrozenModel. Guesses give the same results as before 
+ freezing. Once frozen the classifier can still guess and be saved, but any 
+ attempt to train it or to strip it will raise an exception.
+ */
+- (void)freeze;
+
+/** Compare the guesses of the receiver with those of a reference classifier.
+ 
+ Typically used on a held-out set of files to compare a compacted classifier 
+ with its full precision original.
+ @param reference The classifier to compare with.
+ @param paths The paths to the files on which both classifiers will guess.
+ @return A dictionary holding the keys @c BKComparisonDocumentsKey, 
+ @c BKComparisonAgreementKey, @c BKComparisonMeanDeltaKey and 
+ @c BKComparisonMaxDeltaKey.
+ */
+- (NSDictionary*)compareWithClassifier:(BKClassifier*)reference onFiles:(NSArray*)paths;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Synchronizing replicas
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns a checksum of every token's count in every pool and in the corpus.
+ 
+ The corpus being summed from the pools, each count in a pool weighs both for 
+ the pool and for the corpus.
+ 
+ The checksum does not depend on the order of the tokens and is updated as the 
+ classifier is trained. It is only computed from scratch, loading every pool, 
+ after stripping, removing a pool or loading an older file.
+ */
+- (uint64_t)checksum;
+
+/** Export the changes made since a checkpoint.
+ 
+ A checkpoint is recorded each time the classifier is saved and each time a
+ delta is exported or applied. The delta holds the new count of every token 
+ changed, the tokens and pools removed, and the checksums before and after.
+ @param baseGeneration The generation of the checkpoint replicas are at.
+ @return The delta, to be given to @c applyDelta:().
+ @exception NSInvalidArgumentException if no checkpoint was recorded for 
+ baseGeneration.
+ */
+- (NSData*)deltaSinceGeneration:(NSUInteger)baseGeneration;
+
+/** Apply in place a delta exported by another classifier.
+ 
+ The pools and tokens changed are updated, and every probability is recomputed
+ the next time it is needed since the corpus' total count changes with any 
+ count.
+ @param delta A delta returned by @c deltaSinceGeneration:().
+ @exception NSInvalidArgumentException if the delta is invalid or was not 
+ exported from the receiver's generation and checksum. The receiver is left 
+ untouched.
+ @exception NSInternalInconsistencyException if the checksum after applying 
+ the delta does not match the exporter's one.
+ */
+- (void)applyDelta:(NSData*)delta;
+
+/** Forget the checkpoints and removals older than a generation.
+ 
+ Deltas can then only be exported since baseGeneration or a later checkpoint. 
+ Every pool is decoded, and the removals forgotten are no longer written by 
+ @c writeToFile:(), so that stripping then shrinks the saved classifier.
+ @param baseGeneration The oldest generation replicas may still be at.
+ */
+- (void)discardChangesBeforeGeneration:(NSUInteger)baseGeneration;
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Getting informations
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -294,5 +551,17 @@
 /// @name Constants
 //////////////////////////////////////////////////////////////////////////////////////////
 
-/** Pool name for the corpus' pool */
+/** Name of the corpus, as used by older archives and by checksums */
 extern NSString* const BKCorpusDataPoolName;
+
+/** Number of documents compared, as an NSNumber */
+extern NSString* const BKComparisonDocumentsKey;
+
+/** Ratio of documents for which both classifiers chose the same pool, as an NSNumber */
+extern NSString* const BKComparisonAgreementKey;
+
+/** Mean of the absolute differences between pools' scores, as an NSNumber */
+extern NSString* const BKComparisonMeanDeltaKey;
+
+/** Largest absolute difference between two pools' scores, as an NSNumber */
+extern NSString* const BKComparisonMaxDeltaKey;
@@ -36,30 +36,112 @@
  */
 
 #import <BayesianKit/BKClassifier.h>
+#import <BayesianKit/BKCorpus.h>
 #import <BayesianKit/BKTokenizer.h>
+#import <BayesianKit/BKTokenData.h>
+#import "BKHashing.h"
+#import "BKProbabilities.h"
+#import <dispatch/dispatch.h>
 
 NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
 
+NSString* const BKComparisonDocumentsKey = @"Documents";
+NSString* const BKComparisonAgreementKey = @"Agreement";
+NSString* const BKComparisonMeanDeltaKey = @"MeanDelta";
+NSString* const BKComparisonMaxDeltaKey = @"MaxDelta";
+
+// Files holding pools in sections start with this magic, followed by the header's length
+static const char BKSectionedFileMagic[8] = {'B', 'K', 'P', 'O', 'O', 'L', 'S', '1'};
+
+// Data of a section, given by its offset and length, without copying the mapping
+static NSData *BKMappedSection(const uint8_t *sections, NSUInteger length, NSArray *location)
+{
+    BOOL isLocation = [location isKindOfClass:[NSArray class]] && [location count] == 2;
+    uint64_t start = isLocation ? [[location objectAtIndex:0] unsignedLongLongValue] : UINT64_MAX;
+    uint64_t sectionLength = isLocation ? [[location objectAtIndex:1] unsignedLongLongValue] : UINT64_MAX;
+    if (start > length || sectionLength > length - start) return nil;
+    
+    return [[[NSData alloc] initWithBytesNoCopy:(void*)(sections + start) 
+                                         length:(NSUInteger)sectionLength 
+                                   freeWhenDone:NO] autorelease];
+}
+
 @interface BKClassifier (Private)
 + (float)chiSquare:(float)chi withDegreeOfFreedom:(NSUInteger)df;
-- (void)buildProbabilityCache;
++ (NSString*)bestPoolInResults:(NSDictionary*)results;
+- (void)buildProbabilityCacheForPools:(NSArray*)stalePools;
+- (BKDataPool*)loadedPoolNamed:(NSString*)poolName;
+- (void)loadAllPools;
+- (void)mapPoolsSectionsOfFile:(NSData*)file fromOffset:(NSUInteger)offset;
+- (BKCorpus*)newCorpus;
+- (NSDictionary*)scoreTokens:(NSArray*)tokens inPools:(NSArray*)poolNames;
+- (float)combineProbabilities:(NSArray*)probabilities;
+- (void)raiseIfReadOnly;
+- (void)invalidateProbabilities;
+- (void)addSignificantTokensOfPool:(BKDataPool*)pool;
+- (void)startGeneration;
+- (void)recordCheckpoint;
+- (NSUInteger)latestCheckpoint;
+- (uint64_t)checksumOfPool:(BKDataPool*)pool;
+- (void)applyChanges:(NSDictionary*)changes toPool:(BKDataPool*)pool;
 @end
 
 
 
+// Guesses on documents with more tokens than this allocate their probabilities buffer
+#define BKStackProbabilitiesCount 1024
+
+// Columns are cut in chunks of this many tokens for the parallel rebuild
+#define BKProbabilityChunkSize 2048
+
+// Columns of a pool gathered for the probabilities rebuild
+typedef struct {
+    NSString **tokens;
+    BKTokenData **tokensData;
+    uint8_t *significant;
+    NSUInteger count;
+    float poolTotal;
+    float deltaTotal;
+    BOOL emptyPool;
+} BKPoolColumns;
+
+typedef struct {
+    BKPoolColumns *column;
+    NSUInteger start;
+    NSUInteger length;
+} BKProbabilityChunk;
+
+// Weight of one occurence of a token in a pool within the checksum. The 
+// checksum sums count * weight, so a count changing from a to b only adds 
+// (b - a) * weight whatever the order of the changes.
+static inline uint64_t BKChecksumWeight(uint64_t poolHash, uint64_t tokenHash)
+{
+    return BKMixHash(poolHash ^ (tokenHash * 0x9e3779b97f4a7c15ULL)) | 1;
+}
+
+// The corpus is summed from the pools, so an occurence in a pool also weighs 
+// for the corpus
+static inline uint64_t BKPoolChecksumWeight(uint64_t poolHash, uint64_t corpusHash, uint64_t tokenHash)
+{
+    return BKChecksumWeight(poolHash, tokenHash) + BKChecksumWeight(corpusHash, tokenHash);
+}
+
+
 @implementation BKClassifier
 
-@synthesize pools;
-@synthesize probabilitiesCombinerInvocation;
 @synthesize tokenizer;
+@synthesize generation;
 
 - (id)init
 {
     self = [super init];
     if (self) {
-        corpus = [[BKDataPool alloc] initWithName:BKCorpusDataPoolName];
         pools = [[NSMutableDictionary alloc] init];
-        dirty = YES;
+        archivedPools = [[NSMutableDictionary alloc] init];
+        cachedPools = [[NSMutableSet alloc] init];
+        significantPools = [[NSMutableSet alloc] init];
+        checkpoints = [[NSMutableDictionary alloc] init];
+        removedPools = [[NSMutableDictionary alloc] init];
         
         [self setProbabilitiesCombinerWithTarget:self 
                                         selector:@selector(robinsonFisherCombinerOn:userInfo:) 
@@ -72,17 +154,51 @@ NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
 
 - (id)initWithContentsOfFile:(NSString*)path
 {
-    self = [[NSKeyedUnarchiver unarchiveObjectWithFile:path] retain];
-    if (self) {
+    NSData *file = [NSData dataWithContentsOfMappedFile:path];
+    const uint8_t *bytes = [file bytes];
+    NSUInteger headerStart = sizeof(BKSectionedFileMagic) + sizeof(uint64_t);
+    
+    if ([file length] < headerStart || memcmp(bytes, BKSectionedFileMagic, sizeof(BKSectionedFileMagic)) != 0) {
+        // Older files, and compact or frozen ones, are a single keyed archive
+        self = [[NSKeyedUnarchiver unarchiveObjectWithFile:path] retain];
+        return self;
     }
+    
+    uint64_t headerLength;
+    memcpy(&headerLength, bytes + sizeof(BKSectionedFileMagic), sizeof(headerLength));
+    headerLength = NSSwapLittleLongLongToHost(headerLength);
+    if (headerLength > [file length] - headerStart) {
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:@"The header lies outside of the file" 
+                                     userInfo:nil];
+    }
+    
+    NSData *header = [NSData dataWithBytesNoCopy:(void*)(bytes + headerStart) 
+                                          length:(NSUInteger)headerLength 
+                                    freeWhenDone:NO];
+    self = [[NSKeyedUnarchiver unarchiveObjectWithData:header] retain];
+    [self mapPoolsSectionsOfFile:file fromOffset:headerStart + (NSUInteger)headerLength];
     return self;
 }
 
 
 - (void)dealloc
 {
-    [corpus release];
+    [compactModel release];
+    [frozenModel release];
+    [resultCache release];
     [pools release];
+    [archivedPools release];
+    [poolsSections release];
+    [corpusSection release];
+    [mappedFile release];
+    [savedCorpus release];
+    [savedPools release];
+    [cachedPools release];
+    [significantPools release];
+    [significantTokens release];
+    [checkpoints release];
+    [removedPools release];
     [super dealloc];
 }
 
@@ -93,10 +209,48 @@ NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
     self = [super init];
     if (self) {
         tokenizer = [[BKTokenizer alloc] init];
-        dirty = YES;
+        cachedPools = [[NSMutableSet alloc] init];
+        significantPools = [[NSMutableSet alloc] init];
         
-        corpus = [[coder decodeObjectForKey:@"Corpus"] retain];
-        pools = [[coder decodeObjectForKey:@"Pools"] retain];
+        compactModel = [[coder decodeObjectForKey:@"Compact"] retain];
+        frozenModel = [[coder decodeObjectForKey:@"Frozen"] retain];
+        if (compactModel || frozenModel) {
+            pools = [[NSMutableDictionary alloc] init];
+            archivedPools = [[NSMutableDictionary alloc] init];
+        } else {
+            generation = [coder decodeIntegerForKey:@"Generation"];
+            archivedPools = [[coder decodeObjectForKey:@"ArchivedPools"] mutableCopy];
+            poolsSections = [[coder decodeObjectForKey:@"PoolsSections"] retain];
+            corpusSection = [[coder decodeObjectForKey:@"CorpusSection"] retain];
+            vocabularyCount = [coder decodeIntegerForKey:@"VocabularyCount"];
+            if (archivedPools) {
+                pools = [[NSMutableDictionary alloc] init];
+            } else if (poolsSections) {
+                // Pools are read from the file's sections by initWithContentsOfFile:
+                pools = [[NSMutableDictionary alloc] init];
+                archivedPools = [[NSMutableDictionary alloc] init];
+            } else {
+                // Older archives hold every pool already decoded
+                pools = [[coder decodeObjectForKey:@"Pools"] retain];
+                archivedPools = [[NSMutableDictionary alloc] init];
+            }
+            
+            // Probabilities of these pools were up to date when saved
+            NSArray *cachedPoolNames = [coder decodeObjectForKey:@"CachedPools"];
+            if (cachedPoolNames) [cachedPools addObjectsFromArray:cachedPoolNames];
+            
+            // Older archives store the corpus, which may still count removed pools
+            BOOL storedCorpus = [coder containsValueForKey:@"CorpusCounts"] || [coder containsValueForKey:@"Corpus"];
+            if ([coder containsValueForKey:@"Checksum"] && !storedCorpus) {
+                checksum = (uint64_t)[coder decodeInt64ForKey:@"Checksum"];
+            } else {
+                checksumOutdated = YES;
+            }
+        }
+        checkpoints = [[coder decodeObjectForKey:@"Checkpoints"] mutableCopy];
+        if (checkpoints == nil) checkpoints = [[NSMutableDictionary alloc] init];
+        removedPools = [[coder decodeObjectForKey:@"RemovedPools"] mutableCopy];
+        if (removedPools == nil) removedPools = [[NSMutableDictionary alloc] init];
         
         [self setProbabilitiesCombinerWithTarget:self 
                                         selector:@selector(robinsonFisherCombinerOn:userInfo:) 
@@ -107,8 +261,33 @@ NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
 
 - (void)encodeWithCoder:(NSCoder*)coder
 {
-    [coder encodeObject:corpus forKey:@"Corpus"];
-    [coder encodeObject:pools forKey:@"Pools"];
+    if (compactModel) {
+        [coder encodeObject:compactModel forKey:@"Compact"];
+    } else if (frozenModel) {
+        [coder encodeObject:frozenModel forKey:@"Frozen"];
+    } else {
+        if (poolsSections) {
+            // Header of a file written by writeToFile:, pools follow it
+            [coder encodeObject:poolsSections forKey:@"PoolsSections"];
+            [coder encodeObject:corpusSection forKey:@"CorpusSection"];
+            [coder encodeInteger:vocabularyCount forKey:@"VocabularyCount"];
+        } else {
+            // Each pool is archived on its own so it can be decoded on demand,
+            // pools never decoded are written back untouched
+            NSMutableDictionary *poolsArchives = [NSMutableDictionary dictionaryWithDictionary:archivedPools];
+            for (NSString *poolName in pools) {
+                NSData *poolArchive = [NSKeyedArchiver archivedDataWithRootObject:[pools objectForKey:poolName]];
+                [poolsArchives setObject:poolArchive forKey:poolName];
+            }
+            [coder encodeObject:poolsArchives forKey:@"ArchivedPools"];
+        }
+        [coder encodeObject:[cachedPools allObjects] forKey:@"CachedPools"];
+        
+        [coder encodeInteger:generation forKey:@"Generation"];
+        if (!checksumOutdated) [coder encodeInt64:(int64_t)checksum forKey:@"Checksum"];
+        [coder encodeObject:checkpoints forKey:@"Checkpoints"];
+        [coder encodeObject:removedPools forKey:@"RemovedPools"];
+    }
 }
 
 #pragma mark -
@@ -122,69 +301,278 @@ NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
 #pragma mark Saving Methods
 - (BOOL)writeToFile:(NSString*)path
 {
-    return [NSKeyedArchiver archiveRootObject:self toFile:path];
+    if (compactModel || frozenModel) {
+        return [NSKeyedArchiver archiveRootObject:self toFile:path];
+    }
+    [self recordCheckpoint];
+    // Readers of the file never rebuild probabilities, stale pools are rebuilt here
+    [self updatePoolsProbabilities];
+    
+    // Each pool is archived in a section of its own, located from the header by 
+    // its offset, so that a mapped file only pages in the pools which are used
+    NSMutableData *sections = [NSMutableData data];
+    NSMutableDictionary *locations = [NSMutableDictionary dictionary];
+    for (NSString *poolName in [self poolNames]) {
+        NSData *poolArchive = [archivedPools objectForKey:poolName];
+        if (poolArchive == nil) {
+            poolArchive = [NSKeyedArchiver archivedDataWithRootObject:[pools objectForKey:poolName]];
+        }
+        NSArray *location = [NSArray arrayWithObjects:
+                             [NSNumber numberWithUnsignedLongLong:[sections length]], 
+                             [NSNumber numberWithUnsignedLongLong:[poolArchive length]], nil];
+        [locations setObject:location forKey:poolName];
+        [sections appendData:poolArchive];
+    }
+    
+    // The corpus of the pools written follows them, later rebuilds start from it
+    BKCorpus *corpus = [self newCorpus];
+    NSData *corpusArchive = [NSKeyedArchiver archivedDataWithRootObject:corpus];
+    vocabularyCount = [corpus tokensCount];
+    [corpus release];
+    corpusSection = [[NSArray alloc] initWithObjects:
+                     [NSNumber numberWithUnsignedLongLong:[sections length]], 
+                     [NSNumber numberWithUnsignedLongLong:[corpusArchive length]], nil];
+    [sections appendData:corpusArchive];
+    
+    poolsSections = [locations retain];
+    NSData *header = [NSKeyedArchiver archivedDataWithRootObject:self];
+    [poolsSections release];
+    poolsSections = nil;
+    [corpusSection release];
+    corpusSection = nil;
+    
+    uint64_t headerLength = NSSwapHostLongLongToLittle([header length]);
+    NSMutableData *file = [NSMutableData dataWithCapacity:sizeof(BKSectionedFileMagic) + sizeof(headerLength) + 
+                                                          [header length] + [sections length]];
+    [file appendBytes:BKSectionedFileMagic length:sizeof(BKSectionedFileMagic)];
+    [file appendBytes:&headerLength length:sizeof(headerLength)];
+    [file appendData:header];
+    [file appendData:sections];
+    
+    return [file writeToFile:path atomically:YES];
 }
 
 #pragma mark -
 #pragma mark Pool Management
+- (NSMutableDictionary*)pools
+{
+    [self loadAllPools];
+    return pools;
+}
+
 - (BKDataPool*)poolNamed:(NSString*)poolName
 {
     BKDataPool *pool;
-    pool = [pools objectForKey:poolName];
+    pool = [self loadedPoolNamed:poolName];
     
     if (pool == nil) {
+        [self raiseIfReadOnly];
         pool = [[[BKDataPool alloc] initWithName:poolName] autorelease];
         [pools setObject:pool forKey:poolName];
-        dirty = YES;
+        [resultCache removeResultsForPoolNamed:poolName];
     }
     return pool;
 }
 
+- (NSArray*)poolNames
+{
+    if (compactModel) return [compactModel poolNames];
+    if (frozenModel) return [frozenModel poolNames];
+    
+    NSMutableArray *poolNames = [NSMutableArray arrayWithArray:[pools allKeys]];
+    [poolNames addObjectsFromArray:[archivedPools allKeys]];
+    return poolNames;
+}
+
 - (void)removePoolNamed:(NSString*)poolName
 {
+    [self raiseIfReadOnly];
+    if ([pools objectForKey:poolName] == nil && [archivedPools objectForKey:poolName] == nil) return;
+    
+    [self startGeneration];
+    [removedPools setObject:[NSNumber numberWithUnsignedInteger:generation] forKey:poolName];
+    checksumOutdated = YES;
+    
     [pools removeObjectForKey:poolName];
-    dirty = YES;
+    [archivedPools removeObjectForKey:poolName];
+    // Its counts leave the corpus, which every pool's probabilities depend on
+    [self invalidateProbabilities];
+    [resultCache removeAllResults];
 }
 
 #pragma mark -
 #pragma mark Probabilities
 - (void)updatePoolsProbabilities
 {
-    if (dirty) {
-        [self buildProbabilityCache];
-        dirty = NO;
-    }
+    [self updateProbabilitiesOfPoolsNamed:[self poolNames]];
 }
 
-- (void)buildProbabilityCache
+- (void)updateProbabilitiesOfPoolsNamed:(NSArray*)poolNames
 {
-    for (NSString *poolName in pools) {
-        BKDataPool *pool = [pools objectForKey:poolName];
+    if (compactModel || frozenModel) return;
+    
+    NSMutableArray *stalePools = [NSMutableArray arrayWithCapacity:[poolNames count]];
+    for (NSString *poolName in poolNames) {
+        if ([cachedPools containsObject:poolName]) {
+            // Decoded pools saved up to date only need their tokens in the filter
+            BKDataPool *pool = [pools objectForKey:poolName];
+            if (pool && ![significantPools containsObject:poolName]) [self addSignificantTokensOfPool:pool];
+            continue;
+        }
         
+        BKDataPool *pool = [self loadedPoolNamed:poolName];
+        if (pool) [stalePools addObject:pool];
+    }
+    
+    if ([stalePools count] > 0) [self buildProbabilityCacheForPools:stalePools];
+}
+
+- (void)buildProbabilityCacheForPools:(NSArray*)stalePools
+{
+    // Derived once for every stale pool, and released with the columns
+    BKCorpus *corpus = [self newCorpus];
+    
+    // Sized for the whole vocabulary, the filter is then shared by every pool
+    if (significantTokens == nil) {
+        significantTokens = [[BKBloomFilter alloc] initWithCapacity:[corpus tokensCount]];
+    }
+    
+    NSUInteger poolsCount = [stalePools count];
+    BKPoolColumns *columns = calloc(poolsCount, sizeof(BKPoolColumns));
+    NSUInteger chunksCount = 0;
+    
+    for (NSUInteger poolIdx = 0; poolIdx < poolsCount; poolIdx++) {
+        BKDataPool *pool = [stalePools objectAtIndex:poolIdx];
+        BKPoolColumns *column = &columns[poolIdx];
         NSUInteger poolTotalCount = [pool tokensTotalCount];
-        NSUInteger deltaTotalCount = MAX([corpus tokensTotalCount] - poolTotalCount, 1u);
         
-        for (NSString *token in pool) {
-            NSUInteger corpusCount = [corpus countForToken:token];
-            NSUInteger poolCount   = [pool countForToken:token];
-            NSUInteger deltaCount  = corpusCount - poolCount;
-            
-            float goodMetric;
-            if (poolTotalCount == 0) {
-                goodMetric = 1.f;
+        column->count = [pool tokensCount];
+        column->tokens = malloc(MAX(column->count, 1u) * sizeof(NSString*));
+        column->tokensData = malloc(MAX(column->count, 1u) * sizeof(BKTokenData*));
+        column->significant = calloc(MAX(column->count, 1u), sizeof(uint8_t));
+        [pool getTokens:column->tokens tokensData:column->tokensData];
+        
+        column->poolTotal = (float)poolTotalCount;
+        column->deltaTotal = (float)MAX([corpus tokensTotalCount] - poolTotalCount, 1u);
+        column->emptyPool = (poolTotalCount == 0);
+        
+        chunksCount += (column->count + BKProbabilityChunkSize - 1) / BKProbabilityChunkSize;
+    }
+    
+    BKProbabilityChunk *chunks = malloc(MAX(chunksCount, 1u) * sizeof(BKProbabilityChunk));
+    NSUInteger chunkIdx = 0;
+    for (NSUInteger poolIdx = 0; poolIdx < poolsCount; poolIdx++) {
+        for (NSUInteger start = 0; start < columns[poolIdx].count; start += BKProbabilityChunkSize) {
+            chunks[chunkIdx].column = &columns[poolIdx];
+            chunks[chunkIdx].start = start;
+            chunks[chunkIdx].length = MIN(BKProbabilityChunkSize, columns[poolIdx].count - start);
+            chunkIdx++;
+        }
+    }
+    
+    // Chunks only read the corpus and write the probabilities of their own tokens,
+    // so pools and token ranges are spread over every core
+    dispatch_apply(chunksCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t idx) {
+        BKProbabilityChunk chunk = chunks[idx];
+        NSString **tokens = chunk.column->tokens + chunk.start;
+        BKTokenData **tokensData = chunk.column->tokensData + chunk.start;
+        uint8_t *significant = chunk.column->significant + chunk.start;
+        
+        NSUInteger corpusCount[BKProbabilityChunkSize];
+        float poolCount[BKProbabilityChunkSize];
+        float deltaCount[BKProbabilityChunkSize];
+        float probability[BKProbabilityChunkSize];
+        
+        [corpus getCounts:corpusCount forTokens:tokens count:chunk.length];
+        for (NSUInteger i = 0; i < chunk.length; i++) {
+            NSUInteger count = [tokensData[i] count];
+            poolCount[i] = (float)count;
+            deltaCount[i] = (float)(corpusCount[i] - count);
+        }
+        
+        BKComputeProbabilities(poolCount, deltaCount, chunk.length, chunk.column->poolTotal,
+                               chunk.column->deltaTotal, chunk.column->emptyPool, probability);
+        
+        for (NSUInteger i = 0; i < chunk.length; i++) {
+            if (probability[i] != BKNotSignificant) {
+                [tokensData[i] setProbability:probability[i]];
+                significant[i] = 1;
             } else {
-                goodMetric = MIN(1.f, (float)deltaCount/(float)poolTotalCount);
+                // Probabilities computed by a previous build are kept
+                significant[i] = ([tokensData[i] probability] > 0.f);
             }
-            float badMetric = MIN(1.f, (float)poolCount/(float)deltaTotalCount);
-            float f = badMetric / (goodMetric + badMetric);
-            
-            if (fabs(f - 0.5f) >= 0.1) [pool setProbability:f forToken:token];
         }
+    });
+    
+    // The filter is not thread safe, it is filled once every chunk is done
+    for (NSUInteger poolIdx = 0; poolIdx < poolsCount; poolIdx++) {
+        BKPoolColumns *column = &columns[poolIdx];
+        for (NSUInteger i = 0; i < column->count; i++) {
+            if (column->significant[i]) [significantTokens addToken:column->tokens[i]];
+        }
+        [cachedPools addObject:[[stalePools objectAtIndex:poolIdx] name]];
+        [significantPools addObject:[[stalePools objectAtIndex:poolIdx] name]];
+        
+        free(column->tokens);
+        free(column->tokensData);
+        free(column->significant);
     }
+    free(chunks);
+    free(columns);
+    [corpus release];
+}
+
+#pragma mark -
+#pragma mark Result Cache
+- (BKResultCache*)resultCache
+{
+    return resultCache;
+}
+
+- (NSUInteger)resultCacheCapacity
+{
+    return [resultCache capacity];
+}
+
+- (void)setResultCacheCapacity:(NSUInteger)capacity
+{
+    [resultCache release];
+    resultCache = nil;
+    
+    if (capacity > 0) {
+        resultCache = [[BKResultCache alloc] initWithCapacity:capacity];
+        [resultCache setMaximumDistance:resultCacheMaximumDistance];
+    }
+}
+
+- (NSUInteger)resultCacheMaximumDistance
+{
+    return resultCacheMaximumDistance;
+}
+
+- (void)setResultCacheMaximumDistance:(NSUInteger)distance
+{
+    resultCacheMaximumDistance = distance;
+    [resultCache setMaximumDistance:distance];
+    [resultCache removeAllResults];
 }
 
 #pragma mark -
 #pragma mark Combiners
+- (NSInvocation*)probabilitiesCombinerInvocation
+{
+    return [[probabilitiesCombinerInvocation retain] autorelease];
+}
+
+- (void)setProbabilitiesCombinerInvocation:(NSInvocation*)invocation
+{
+    if (invocation != probabilitiesCombinerInvocation) {
+        [probabilitiesCombinerInvocation release];
+        probabilitiesCombinerInvocation = [invocation retain];
+    }
+    [resultCache removeAllResults];
+}
+
 - (void)setProbabilitiesCombinerWithTarget:(id)target selector:(SEL)selector userInfo:(id)userInfo
 {
     SEL signatureSelector = @selector(robinsonCombinerOn:userInfo:);
@@ -261,103 +649,430 @@ NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
 #pragma mark Trainning Methods
 - (void)trainWithFile:(NSString*)path forPoolNamed:(NSString*)poolName
 {
+    NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
     NSError *error = nil;
     NSString *content = [NSString stringWithContentsOfFile:path 
                                                   encoding:NSUTF8StringEncoding 
                                                      error:&error];
     if (error) {
         NSLog(@"Error - %@", [error localizedDescription]);
-        return;
+    } else {
+        [self trainWithString:content forPoolNamed:poolName];
+    }
+    [autoreleasePool drain];
+}
+
+- (void)trainWithFiles:(NSArray*)paths forPoolNamed:(NSString*)poolName
+{
+    for (NSString *path in paths) {
+        [self trainWithFile:path forPoolNamed:poolName];
     }
-    [self trainWithString:content forPoolNamed:poolName];
 }
 
 - (void)trainWithString:(NSString*)trainString forPoolNamed:(NSString*)poolName
 {
+    NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
     NSArray *tokens = [tokenizer tokenizeString:trainString];
     BKDataPool *pool = [self poolNamed:poolName];
     [self trainWithTokens:tokens inPool:pool];
+    [autoreleasePool drain];
 }
 
 - (void)trainWithTokens:(NSArray*)tokens inPool:(BKDataPool*)pool
 {
+    [self raiseIfReadOnly];
+    [self startGeneration];
+    [pool setGeneration:generation];
+    
+    uint64_t poolHash = BKHashString([pool name]);
+    uint64_t corpusHash = BKHashString(BKCorpusDataPoolName);
+    
+    // Only the pool is counted, the corpus is summed from the pools when needed
     for (NSString *token in tokens) {
         if (!token || [token isEqual:@""]) continue;
         [pool increaseCountForToken:token];
-        [corpus increaseCountForToken:token];
+        
+        if (!checksumOutdated) {
+            checksum += BKPoolChecksumWeight(poolHash, corpusHash, BKHashString(token));
+        }
     }
-    dirty = YES;
+    [self invalidateProbabilities];
+    [resultCache removeAllResults];
 }
 
 #pragma mark -
 #pragma mark Guessing Methods
 - (NSDictionary*)guessWithFile:(NSString*)path
 {
+    return [self guessWithFile:path inPools:nil];
+}
+
+- (NSDictionary*)guessWithFile:(NSString*)path inPools:(NSArray*)poolNames
+{
+    NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
+    NSDictionary *result = nil;
     NSError *error = nil;
     NSString *content = [NSString stringWithContentsOfFile:path 
                                                   encoding:NSUTF8StringEncoding 
                                                      error:&error];
     if (error) {
         NSLog(@"Error - %@", [error localizedDescription]);
-        return nil;
+    } else {
+        result = [[self guessWithString:content inPools:poolNames] retain];
     }
-    return [self guessWithString:content];
+    [autoreleasePool drain];
+    return [result autorelease];
 }
 
 - (NSDictionary*)guessWithString:(NSString*)string
 {
+    return [self guessWithString:string inPools:nil];
+}
+
+- (NSDictionary*)guessWithString:(NSString*)string inPools:(NSArray*)poolNames
+{
+    NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
     NSArray *tokens = [tokenizer tokenizeString:string];
-    return [self guessWithTokens:tokens];
+    NSDictionary *result = [[self guessWithTokens:tokens inPools:poolNames] retain];
+    [autoreleasePool drain];
+    return [result autorelease];
 }
 
 - (NSDictionary*)guessWithTokens:(NSArray*)tokens
 {
-    [self updatePoolsProbabilities];
-    NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity:[pools count]];
+    return [self guessWithTokens:tokens inPools:nil];
+}
+
+- (NSDictionary*)guessWithTokens:(NSArray*)tokens inPools:(NSArray*)poolNames
+{
+    if (resultCache == nil) return [self scoreTokens:tokens inPools:poolNames];
     
-    for (NSString *poolName in pools) {
+    BKTokensSignature signature = [resultCache signatureForTokens:tokens inPools:poolNames];
+    NSDictionary *result = [resultCache resultForSignature:signature inPools:poolNames];
+    if (result == nil) {
+        result = [self scoreTokens:tokens inPools:poolNames];
+        [resultCache setResult:result forSignature:signature inPools:poolNames];
+    }
+    return result;
+}
+
+- (NSDictionary*)scoreTokens:(NSArray*)tokens inPools:(NSArray*)poolNames
+{
+    if (compactModel || frozenModel) {
+        NSDictionary *probabilities;
+        if (compactModel) {
+            probabilities = [compactModel probabilitiesForTokens:tokens inPools:poolNames];
+        } else {
+            probabilities = [frozenModel probabilitiesForTokens:tokens inPools:poolNames];
+        }
+        NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity:[probabilities count]];
+        
+        for (NSString *poolName in probabilities) {
+            float probabilityCombined = [self combineProbabilities:[probabilities objectForKey:poolName]];
+            [result setObject:[NSNumber numberWithFloat:probabilityCombined]
+                       forKey:poolName];
+        }
+        return result;
+    }
+    
+    if (poolNames == nil) poolNames = [self poolNames];
+    // Pools saved up to date were not rebuilt, and may not be decoded yet
+    for (NSString *poolName in poolNames) {
+        [self loadedPoolNamed:poolName];
+    }
+    [self updateProbabilitiesOfPoolsNamed:poolNames];
+    
+    // Tokens without any probability are dropped before reaching the pools
+    if (significantTokens) {
+        NSMutableArray *candidates = [NSMutableArray arrayWithCapacity:[tokens count]];
+        for (NSString *token in tokens) {
+            if ([significantTokens mayContainToken:token]) [candidates addObject:token];
+        }
+        tokens = candidates;
+    }
+    
+    NSMutableDictionary *result = [[NSMutableDictionary alloc] initWithCapacity:[poolNames count]];
+    // Probabilities are gathered in a buffer of the call's own, on the stack for most documents
+    float stackProbabilities[BKStackProbabilitiesCount];
+    float *probabilities = stackProbabilities;
+    if ([tokens count] > BKStackProbabilitiesCount) probabilities = malloc(sizeof(float) * [tokens count]);
+    
+    for (NSString *poolName in poolNames) {
         BKDataPool *pool = [pools objectForKey:poolName];
-        NSArray *tokensProbabilities = [pool probabilitiesForTokens:tokens];
+        if (pool == nil) continue;
+        
+        NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
+        NSUInteger count = [pool getProbabilities:probabilities forTokens:tokens];
         
-        if ([tokensProbabilities count] > 0) {
-            float probabilityCombined;
-            [probabilitiesCombinerInvocation setArgument:&tokensProbabilities atIndex:2];
-            [probabilitiesCombinerInvocation invoke];
-            [probabilitiesCombinerInvocation getReturnValue:&probabilityCombined];
+        if (count > 0) {
+            qsort(probabilities, count, sizeof(float), BKCompareFloats);
+            NSMutableArray *tokensProbabilities = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger idx = 0; idx < count; idx++) {
+                [tokensProbabilities addObject:[NSNumber numberWithFloat:probabilities[idx]]];
+            }
+            
+            float probabilityCombined = [self combineProbabilities:tokensProbabilities];
             [result setObject:[NSNumber numberWithFloat:probabilityCombined]
                        forKey:poolName];
         }
+        [autoreleasePool drain];
     }
     
-    return result;
+    if (probabilities != stackProbabilities) free(probabilities);
+    return [result autorelease];
 }
 
 #pragma mark -
 #pragma mark Sanitizing Methods
 - (void)stripToLevel:(NSUInteger)level
 {
-    for (NSString *token in [corpus allTokens]) {
-        NSUInteger count = [corpus countForToken:token];
+    [self raiseIfReadOnly];
+    [self loadAllPools];
+    [self startGeneration];
+    for (NSString *poolName in pools) {
+        [[pools objectForKey:poolName] setGeneration:generation];
+    }
+    checksumOutdated = YES;
+    
+    // A single scan of the summed counts column finds every token to remove
+    BKCorpus *corpus = [[BKCorpus alloc] initWithPools:[pools allValues]];
+    NSUInteger checkpointGeneration = [self latestCheckpoint];
+    for (NSString *token in [corpus tokensCountedLessThan:level]) {
+        for (NSString *poolName in pools) {
+            BKDataPool *pool = [pools objectForKey:poolName];
+            [pool removeToken:token sinceCheckpoint:checkpointGeneration];
+        }
+    }
+    [corpus release];
+    [self invalidateProbabilities];
+    [resultCache removeAllResults];
+}
+
+#pragma mark -
+#pragma mark Compacting Methods
+- (BOOL)isCompact
+{
+    return compactModel != nil;
+}
+
+- (void)compactWithQuantizationBits:(NSUInteger)bits
+{
+    [self raiseIfReadOnly];
+    [self updatePoolsProbabilities];
+    
+    compactModel = [[BKCompactModel alloc] initWithPools:[self pools] quantizationBits:bits];
+    
+    [pools removeAllObjects];
+    [self invalidateProbabilities];
+    [resultCache removeAllResults];
+}
+
+- (BOOL)isFrozen
+{
+    return frozenModel != nil;
+}
+
+- (void)freeze
+{
+    [self raiseIfReadOnly];
+    [self updatePoolsProbabilities];
+    
+    frozenModel = [[BKFrozenModel alloc] initWithPools:[self pools]];
+    
+    [pools removeAllObjects];
+    [self invalidateProbabilities];
+    [resultCache removeAllResults];
+}
+
+- (NSDictionary*)compareWithClassifier:(BKClassifier*)reference onFiles:(NSArray*)paths
+{
+    NSUInteger documents = 0, agreements = 0, deltasCount = 0;
+    float deltasSum = 0.f, maxDelta = 0.f;
+    
+    for (NSString *path in paths) {
+        NSDictionary *results = [self guessWithFile:path];
+        NSDictionary *referenceResults = [reference guessWithFile:path];
+        if (results == nil || referenceResults == nil) continue;
         
-        if (count < level) {
-            for (NSString *poolName in pools) {
-                BKDataPool *pool = [pools objectForKey:poolName];
-                [pool removeToken:token];
-            }
-            [corpus removeToken:token];
+        documents++;
+        NSString *best = [BKClassifier bestPoolInResults:results];
+        NSString *referenceBest = [BKClassifier bestPoolInResults:referenceResults];
+        if (best == referenceBest || [best isEqual:referenceBest]) agreements++;
+        
+        NSMutableSet *poolNames = [NSMutableSet setWithArray:[results allKeys]];
+        [poolNames addObjectsFromArray:[referenceResults allKeys]];
+        for (NSString *poolName in poolNames) {
+            float delta = fabsf([[results objectForKey:poolName] floatValue] - 
+                                [[referenceResults objectForKey:poolName] floatValue]);
+            deltasSum += delta;
+            maxDelta = MAX(maxDelta, delta);
+            deltasCount++;
+        }
+    }
+    
+    float agreement = (documents > 0) ? (float)agreements / (float)documents : 1.f;
+    float meanDelta = (deltasCount > 0) ? deltasSum / (float)deltasCount : 0.f;
+    
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithUnsignedInteger:documents], BKComparisonDocumentsKey,
+            [NSNumber numberWithFloat:agreement], BKComparisonAgreementKey,
+            [NSNumber numberWithFloat:meanDelta], BKComparisonMeanDeltaKey,
+            [NSNumber numberWithFloat:maxDelta], BKComparisonMaxDeltaKey,
+            nil];
+}
+
+#pragma mark -
+#pragma mark Synchronizing Methods
+- (uint64_t)checksum
+{
+    if (checksumOutdated) {
+        [self loadAllPools];
+        checksum = 0;
+        for (NSString *poolName in pools) {
+            checksum += [self checksumOfPool:[pools objectForKey:poolName]];
+        }
+        checksumOutdated = NO;
+    }
+    return checksum;
+}
+
+- (NSData*)deltaSinceGeneration:(NSUInteger)baseGeneration
+{
+    [self raiseIfReadOnly];
+    
+    NSNumber *baseChecksum = [checkpoints objectForKey:[NSNumber numberWithUnsignedInteger:baseGeneration]];
+    if (baseChecksum == nil) {
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:[NSString stringWithFormat:@"No checkpoint was recorded at generation %llu", 
+                                               (unsigned long long)baseGeneration]
+                                     userInfo:nil];
+    }
+    [self recordCheckpoint];
+    
+    NSMutableDictionary *poolsChanges = [NSMutableDictionary dictionary];
+    for (NSString *poolName in [self pools]) {
+        BKDataPool *pool = [pools objectForKey:poolName];
+        NSDictionary *counts = [pool countsChangedSinceGeneration:baseGeneration];
+        NSArray *removedTokens = [pool tokensRemovedSinceGeneration:baseGeneration];
+        
+        if ([counts count] > 0 || [removedTokens count] > 0) {
+            [poolsChanges setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                                     counts, @"Counts", removedTokens, @"RemovedTokens", nil]
+                             forKey:poolName];
         }
     }
+    NSMutableArray *poolsRemoved = [NSMutableArray array];
+    for (NSString *poolName in removedPools) {
+        if ([[removedPools objectForKey:poolName] unsignedIntegerValue] > baseGeneration) {
+            [poolsRemoved addObject:poolName];
+        }
+    }
+    
+    NSDictionary *delta = [NSDictionary dictionaryWithObjectsAndKeys:
+                           [NSNumber numberWithUnsignedInteger:baseGeneration], @"BaseGeneration",
+                           baseChecksum, @"BaseChecksum",
+                           [NSNumber numberWithUnsignedInteger:generation], @"Generation",
+                           [NSNumber numberWithUnsignedLongLong:[self checksum]], @"Checksum",
+                           poolsRemoved, @"RemovedPools",
+                           poolsChanges, @"Pools",
+                           nil];
+    return [NSKeyedArchiver archivedDataWithRootObject:delta];
+}
+
+- (void)applyDelta:(NSData*)data
+{
+    [self raiseIfReadOnly];
+    
+    NSDictionary *delta = nil;
+    @try {
+        delta = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+    }
+    @catch (NSException *e) {
+        delta = nil;
+    }
+    if (![delta isKindOfClass:[NSDictionary class]] || [delta objectForKey:@"BaseChecksum"] == nil) {
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:@"Not a valid delta" 
+                                     userInfo:nil];
+    }
+    
+    NSUInteger baseGeneration = [[delta objectForKey:@"BaseGeneration"] unsignedIntegerValue];
+    uint64_t baseChecksum = [[delta objectForKey:@"BaseChecksum"] unsignedLongLongValue];
+    if (baseGeneration != generation || baseChecksum != [self checksum]) {
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:[NSString stringWithFormat:@"The delta applies to generation %llu "
+                                               "but the classifier is at generation %llu, or was changed since", 
+                                               (unsigned long long)baseGeneration, (unsigned long long)generation]
+                                     userInfo:nil];
+    }
+    
+    generation = [[delta objectForKey:@"Generation"] unsignedIntegerValue];
+    
+    for (NSString *poolName in [delta objectForKey:@"RemovedPools"]) {
+        BKDataPool *pool = [self loadedPoolNamed:poolName];
+        if (pool) checksum -= [self checksumOfPool:pool];
+        [pools removeObjectForKey:poolName];
+        [removedPools setObject:[NSNumber numberWithUnsignedInteger:generation] forKey:poolName];
+        [resultCache removeResultsForPoolNamed:poolName];
+    }
+    
+    // Corpus changes of older deltas are already counted in the pools' ones
+    NSDictionary *poolsChanges = [delta objectForKey:@"Pools"];
+    for (NSString *poolName in poolsChanges) {
+        [self applyChanges:[poolsChanges objectForKey:poolName] toPool:[self poolNamed:poolName]];
+    }
+    
+    [self invalidateProbabilities];
+    [resultCache removeAllResults];
+    
+    if (checksum != [[delta objectForKey:@"Checksum"] unsignedLongLongValue]) {
+        checksumOutdated = YES;
+        @throw [NSException exceptionWithName:NSInternalInconsistencyException 
+                                       reason:@"The checksum after applying the delta does not match, "
+                                               "the classifier should be reloaded from a full copy" 
+                                     userInfo:nil];
+    }
+    [self recordCheckpoint];
+}
+
+- (void)discardChangesBeforeGeneration:(NSUInteger)baseGeneration
+{
+    for (NSNumber *checkpoint in [checkpoints allKeys]) {
+        if ([checkpoint unsignedIntegerValue] < baseGeneration) [checkpoints removeObjectForKey:checkpoint];
+    }
+    for (NSString *poolName in [removedPools allKeys]) {
+        if ([[removedPools objectForKey:poolName] unsignedIntegerValue] <= baseGeneration) {
+            [removedPools removeObjectForKey:poolName];
+        }
+    }
+    
+    for (NSString *poolName in [self pools]) {
+        [[pools objectForKey:poolName] discardRemovedTokensUpToGeneration:baseGeneration];
+    }
 }
 
 #pragma mark -
 #pragma mark Printing Methods
 - (void)printInformations
 {
+    if (compactModel) {
+        [compactModel printInformations];
+        return;
+    }
+    if (frozenModel) {
+        [frozenModel printInformations];
+        return;
+    }
+    
     [self updatePoolsProbabilities];
-    [corpus printInformations];
+    NSLog(@"Generation %llu, checksum %016llx", (unsigned long long)generation, 
+          (unsigned long long)[self checksum]);
+    [[[[BKCorpus alloc] initWithPools:[[self pools] allValues]] autorelease] printInformations];
     for (NSString *poolName in pools) {
         [[pools objectForKey:poolName] printInformations];
     }
+    [significantTokens printInformations];
+    [resultCache printInformations];
 }
 
 #pragma mark -
@@ -378,5 +1093,221 @@ NSString* const BKCorpusDataPoolName = @"__BKCorpus__";
     return MIN(sum, 1.0f);
 }
 
++ (NSString*)bestPoolInResults:(NSDictionary*)results
+{
+    NSString *bestPoolName = nil;
+    float bestValue = -1.f;
+    
+    for (NSString *poolName in results) {
+        float value = [[results objectForKey:poolName] floatValue];
+        if (value > bestValue) {
+            bestValue = value;
+            bestPoolName = poolName;
+        }
+    }
+    return bestPoolName;
+}
+
+// The invocation is only read, so that concurrent guesses never write its 
+// arguments, and the combiner is called through its implementation
+- (float)combineProbabilities:(NSArray*)probabilities
+{
+    typedef float (*BKCombinerIMP)(id, SEL, NSArray*, id);
+    
+    id target = [probabilitiesCombinerInvocation target];
+    SEL selector = [probabilitiesCombinerInvocation selector];
+    id userInfo;
+    [probabilitiesCombinerInvocation getArgument:&userInfo atIndex:3];
+    
+    BKCombinerIMP combiner = (BKCombinerIMP)[target methodForSelector:selector];
+    return combiner(target, selector, probabilities, userInfo);
+}
+
+- (BKDataPool*)loadedPoolNamed:(NSString*)poolName
+{
+    BKDataPool *pool = [pools objectForKey:poolName];
+    
+    if (pool == nil) {
+        NSData *poolArchive = [archivedPools objectForKey:poolName];
+        if (poolArchive == nil) return nil;
+        
+        pool = [NSKeyedUnarchiver unarchiveObjectWithData:poolArchive];
+        [pools setObject:pool forKey:poolName];
+        [archivedPools removeObjectForKey:poolName];
+    }
+    return pool;
+}
+
+- (void)loadAllPools
+{
+    for (NSString *poolName in [archivedPools allKeys]) {
+        [self loadedPoolNamed:poolName];
+    }
+}
+
+- (void)mapPoolsSectionsOfFile:(NSData*)file fromOffset:(NSUInteger)offset
+{
+    const uint8_t *sections = (const uint8_t*)[file bytes] + offset;
+    NSUInteger length = [file length] - offset;
+    
+    // Archives point into the mapping, which is kept as long as the classifier
+    for (NSString *poolName in poolsSections) {
+        NSData *poolArchive = BKMappedSection(sections, length, [poolsSections objectForKey:poolName]);
+        if (poolArchive == nil) {
+            @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                           reason:[NSString stringWithFormat:@"The section of pool %@ lies outside of the file", poolName] 
+                                         userInfo:nil];
+        }
+        [archivedPools setObject:poolArchive forKey:poolName];
+    }
+    [poolsSections release];
+    poolsSections = nil;
+    
+    // Saved sections stay reachable once their pools are decoded or removed
+    if (corpusSection) {
+        savedCorpus = [BKMappedSection(sections, length, corpusSection) retain];
+        if (savedCorpus == nil) {
+            @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                           reason:@"The section of the corpus lies outside of the file" 
+                                         userInfo:nil];
+        }
+        savedPools = [archivedPools copy];
+        [corpusSection release];
+        corpusSection = nil;
+    }
+    
+    [mappedFile release];
+    mappedFile = [file retain];
+}
+
+- (BKCorpus*)newCorpus
+{
+    // Without a saved corpus, every pool is decoded and summed
+    if (savedCorpus == nil) {
+        [self loadAllPools];
+        return [[BKCorpus alloc] initWithPools:[pools allValues]];
+    }
+    
+    // The saved corpus counts every pool as it was saved, the pools decoded or 
+    // removed since have their saved counts swapped for their current ones
+    BKCorpus *corpus = [[NSKeyedUnarchiver unarchiveObjectWithData:savedCorpus] retain];
+    if (![corpus isKindOfClass:[BKCorpus class]]) {
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:@"Not a valid corpus" 
+                                     userInfo:nil];
+    }
+    for (NSString *poolName in savedPools) {
+        if ([archivedPools objectForKey:poolName]) continue;
+        
+        NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
+        [corpus subtractCountsOfPool:[NSKeyedUnarchiver unarchiveObjectWithData:[savedPools objectForKey:poolName]]];
+        [autoreleasePool drain];
+    }
+    for (NSString *poolName in pools) {
+        [corpus addCountsOfPool:[pools objectForKey:poolName]];
+    }
+    return corpus;
+}
+
+- (void)raiseIfReadOnly
+{
+    if (compactModel || frozenModel) {
+        @throw [NSException exceptionWithName:NSInternalInconsistencyException 
+                                       reason:@"A compact or frozen classifier is read-only" 
+                                     userInfo:nil];
+    }
+}
+
+- (void)invalidateProbabilities
+{
+    [cachedPools removeAllObjects];
+    [significantPools removeAllObjects];
+    [significantTokens release];
+    significantTokens = nil;
+}
+
+- (void)addSignificantTokensOfPool:(BKDataPool*)pool
+{
+    // Without a rebuild the filter is sized from the vocabulary saved with the file, 
+    // or failing that from this pool's vocabulary for every pool
+    if (significantTokens == nil) {
+        NSUInteger capacity = vocabularyCount;
+        if (capacity == 0) capacity = [pool tokensCount] * MAX([[self poolNames] count], 1u);
+        significantTokens = [[BKBloomFilter alloc] initWithCapacity:capacity];
+    }
+    
+    NSUInteger tokensCount = [pool tokensCount];
+    NSString **tokens = malloc(MAX(tokensCount, 1u) * sizeof(NSString*));
+    BKTokenData **tokensData = malloc(MAX(tokensCount, 1u) * sizeof(BKTokenData*));
+    
+    [pool getTokens:tokens tokensData:tokensData];
+    for (NSUInteger idx = 0; idx < tokensCount; idx++) {
+        if ([tokensData[idx] probability] > 0.f) [significantTokens addToken:tokens[idx]];
+    }
+    [significantPools addObject:[pool name]];
+    
+    free(tokens);
+    free(tokensData);
+}
+
+- (void)startGeneration
+{
+    if (generation == NSUIntegerMax) {
+        @throw [NSException exceptionWithName:@"NSUInteger overflow" 
+                                       reason:@"Too much generations" 
+                                     userInfo:nil];
+    }
+    generation++;
+}
+
+- (void)recordCheckpoint
+{
+    [checkpoints setObject:[NSNumber numberWithUnsignedLongLong:[self checksum]] 
+                    forKey:[NSNumber numberWithUnsignedInteger:generation]];
+}
+
+- (NSUInteger)latestCheckpoint
+{
+    // Tokens of a classifier never saved are all counted after its "checkpoint"
+    NSUInteger latest = 0;
+    for (NSNumber *checkpoint in checkpoints) {
+        latest = MAX(latest, [checkpoint unsignedIntegerValue]);
+    }
+    return latest;
+}
+
+- (uint64_t)checksumOfPool:(BKDataPool*)pool
+{
+    uint64_t poolHash = BKHashString([pool name]);
+    uint64_t corpusHash = BKHashString(BKCorpusDataPoolName);
+    uint64_t poolChecksum = 0;
+    
+    for (NSString *token in pool) {
+        poolChecksum += [pool countForToken:token] * BKPoolChecksumWeight(poolHash, corpusHash, BKHashString(token));
+    }
+    return poolChecksum;
+}
+
+- (void)applyChanges:(NSDictionary*)changes toPool:(BKDataPool*)pool
+{
+    uint64_t poolHash = BKHashString([pool name]);
+    uint64_t corpusHash = BKHashString(BKCorpusDataPoolName);
+    NSUInteger checkpointGeneration = [self latestCheckpoint];
+    [pool setGeneration:generation];
+    
+    for (NSString *token in [changes objectForKey:@"RemovedTokens"]) {
+        checksum -= [pool countForToken:token] * BKPoolChecksumWeight(poolHash, corpusHash, BKHashString(token));
+        [pool removeToken:token sinceCheckpoint:checkpointGeneration];
+    }
+    
+    NSDictionary *newCounts = [changes objectForKey:@"Counts"];
+    for (NSString *token in newCounts) {
+        NSUInteger count = [[newCounts objectForKey:token] unsignedIntegerValue];
+        uint64_t difference = (uint64_t)count - (uint64_t)[pool countForToken:token];
+        checksum += difference * BKPoolChecksumWeight(poolHash, corpusHash, BKHashString(token));
+        [pool setCount:count forToken:token];
+    }
+}
+
 
 @end
@@ -0,0 +1,150 @@
+//
+// BKCompactModel.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Read-only and compressed representation of a classifier's pools.
+ 
+ Every token of every pool is stored once, in a table sorted by UTF-8 bytes and
+ front coded by blocks of 16 tokens: the first token of a block is stored whole,
+ the following ones only keep the length of the prefix shared with the previous
+ token and their own suffix. Each token is directly followed by its row: the 
+ pools it was counted in, its count in each of them as a varint and its 
+ probability quantized in log-odds space on 8 or 16 bits.
+ 
+ Lookups binary search the first token of the blocks and then decode a single 
+ block, scoring is therefore done on the compressed form. Tokens which have no 
+ UTF-8 form, such as strings holding a lone surrogate, are left out of the model.
+ 
+ Decoded archives are walked once and rejected unless every table is consistent.
+ 
+ You should never have to handle an object of this class directly.
+ */
+@interface BKCompactModel : NSObject <NSCoding> {
+    @private
+    NSUInteger _quantizationBits;
+    NSUInteger _tokensCount;
+    NSArray *_poolNames;
+    NSData *_poolsTotalCounts;
+    NSData *_blocksOffsets;
+    NSData *_entries;
+    float *_dequantizationTable;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Properties
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Number of bits used to store a probability, either 8 or 16. */
+@property (readonly, getter=quantizationBits) NSUInteger _quantizationBits;
+
+/** Number of distinct tokens in the model. */
+@property (readonly, getter=tokensCount) NSUInteger _tokensCount;
+
+/** Names of the pools stored in the model, sorted alphabetically. */
+@property (readonly, getter=poolNames) NSArray *_poolNames;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Initializing a compact model
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Initialize a compact model from a group of data pools.
+ 
+ The pools' probabilities must be up to date, see 
+ @c BKClassifier::updatePoolsProbabilities().
+ @param pools A dictionary of @c BKDataPool indexed by their names.
+ @param bits The number of bits used to quantize probabilities, either 8 or 16.
+ @return An initialized compact model.
+ @exception NSInvalidArgumentException if bits is neither 8 nor 16.
+ */
+- (id)initWithPools:(NSDictionary*)pools quantizationBits:(NSUInteger)bits;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Accessing tokens' data
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the number of occurences counted for a token in a pool.
+ 
+ @param token The token to get the count from.
+ @param poolName The name of the pool.
+ @return The number of occurences counted. 0 if no token is found.
+ */
+- (NSUInteger)countForToken:(NSString*)token inPoolNamed:(NSString*)poolName;
+
+/** Returns the total count of tokens of a pool.
+ 
+ @param poolName The name of the pool.
+ @return The total count of tokens. 0 if the pool does not exist.
+ */
+- (NSUInteger)tokensTotalCountForPoolNamed:(NSString*)poolName;
+
+/** Returns the probabilities for a group of tokens in every pools.
+ 
+ Behave like @c BKDataPool::probabilitiesForTokens:() for every pool at once.
+ Pools in which none of the tokens have a probability are not part of the result.
+ @param tokens An array containing tokens.
+ @return A dictionary with pools' names as keys and sorted arrays of NSNumber 
+ holding tokens probabilities as values.
+ */
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens;
+
+/** Returns the probabilities for a group of tokens in some pools.
+ 
+ Like @c probabilitiesForTokens:() but cells of other pools are skipped while
+ decoding the rows.
+ @param tokens An array containing tokens.
+ @param poolNames The names of the pools to look into, nil meaning every pools.
+ @return A dictionary with pools' names as keys and sorted arrays of NSNumber 
+ holding tokens probabilities as values.
+ */
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens inPools:(NSArray*)poolNames;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Print statistics
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the number of bytes used by the encoded tokens and pools. */
+- (NSUInteger)sizeInBytes;
+
+/** Print some basics statistics on the receiver */
+- (void)printInformations;
+
+@end
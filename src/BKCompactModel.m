@@ -0,0 +1,644 @@
+//
+// BKCompactModel.m
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <BayesianKit/BKCompactModel.h>
+#import <BayesianKit/BKDataPool.h>
+#import "BKHashing.h"
+
+#define BKCompactBlockSize 16
+
+// Bounds of the log-odds of a probability, BKTokenData clamps them to [0.0001, 0.9999]
+#define BKCompactLogOddsLimit 9.2102404f
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSString *token;
+} BKCompactToken;
+
+typedef struct {
+    uint32_t pool;
+    uint32_t code;
+    NSUInteger count;
+} BKCompactCell;
+
+typedef struct {
+    uint32_t pool;
+    float probability;
+} BKCompactHit;
+
+@interface BKCompactModel (Private)
+- (void)buildDequantizationTable;
+- (const uint8_t*)rowForToken:(NSString*)token;
+- (BOOL)hasValidTables;
+@end
+
+
+#pragma mark -
+#pragma mark Encoding Functions
+static void BKAppendVarint(NSMutableData *data, uint64_t value)
+{
+    uint8_t buffer[10];
+    NSUInteger length = 0;
+    
+    do {
+        buffer[length] = (uint8_t)(value & 0x7f);
+        value >>= 7;
+        if (value) buffer[length] |= 0x80;
+        length++;
+    } while (value);
+    
+    [data appendBytes:buffer length:length];
+}
+
+static inline uint64_t BKReadVarint(const uint8_t **cursor)
+{
+    const uint8_t *bytes = *cursor;
+    uint64_t value = 0;
+    unsigned int shift = 0;
+    uint8_t byte;
+    
+    do {
+        byte = *bytes++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    
+    *cursor = bytes;
+    return value;
+}
+
+// Same as BKReadVarint, failing instead of reading past the end or overflowing
+static BOOL BKReadCheckedVarint(const uint8_t **cursor, const uint8_t *end, uint64_t *value)
+{
+    const uint8_t *bytes = *cursor;
+    uint64_t result = 0;
+    unsigned int shift = 0;
+    uint8_t byte;
+    
+    do {
+        if (bytes == end || shift > 63) return NO;
+        byte = *bytes++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    
+    *cursor = bytes;
+    *value = result;
+    return YES;
+}
+
+static inline uint32_t BKReadCode(const uint8_t *cursor, NSUInteger codeSize)
+{
+    if (codeSize == 1) return cursor[0];
+    return (uint32_t)cursor[0] | ((uint32_t)cursor[1] << 8);
+}
+
+static const uint8_t *BKSkipRow(const uint8_t *cursor, NSUInteger codeSize)
+{
+    uint64_t cellsCount = BKReadVarint(&cursor);
+    for (; cellsCount > 0; cellsCount--) {
+        BKReadVarint(&cursor);
+        BKReadVarint(&cursor);
+        cursor += codeSize;
+    }
+    return cursor;
+}
+
+static inline NSUInteger BKCommonPrefixLength(const uint8_t *a, NSUInteger aLength, 
+                                              const uint8_t *b, NSUInteger bLength)
+{
+    NSUInteger length = MIN(aLength, bLength);
+    NSUInteger idx = 0;
+    while (idx < length && a[idx] == b[idx]) idx++;
+    return idx;
+}
+
+static inline int BKCompareBytes(const uint8_t *a, NSUInteger aLength, 
+                                 const uint8_t *b, NSUInteger bLength)
+{
+    int result = memcmp(a, b, MIN(aLength, bLength));
+    if (result != 0) return result;
+    if (aLength == bLength) return 0;
+    return (aLength < bLength) ? -1 : 1;
+}
+
+static int BKCompareCompactTokens(const void *a, const void *b)
+{
+    const BKCompactToken *x = a;
+    const BKCompactToken *y = b;
+    return BKCompareBytes(x->bytes, x->length, y->bytes, y->length);
+}
+
+static uint32_t BKQuantizeProbability(float probability, NSUInteger bits)
+{
+    if (probability <= 0.f) return 0;
+    
+    uint32_t levels = (1u << bits) - 1;
+    float step = (2.f * BKCompactLogOddsLimit) / (float)(levels - 1);
+    float logOdds = logf(probability / (1.f - probability));
+    logOdds = MAX(-BKCompactLogOddsLimit, MIN(BKCompactLogOddsLimit, logOdds));
+    
+    return 1 + (uint32_t)lroundf((logOdds + BKCompactLogOddsLimit) / step);
+}
+
+
+@implementation BKCompactModel
+
+@synthesize _quantizationBits;
+@synthesize _tokensCount;
+@synthesize _poolNames;
+
+- (id)initWithPools:(NSDictionary*)pools quantizationBits:(NSUInteger)bits
+{
+    if (bits != 8 && bits != 16) {
+        [self release];
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:@"Probabilities can only be quantized on 8 or 16 bits" 
+                                     userInfo:nil];
+    }
+    
+    self = [super init];
+    if (self) {
+        _quantizationBits = bits;
+        _poolNames = [[[pools allKeys] sortedArrayUsingSelector:@selector(compare:)] retain];
+        
+        NSUInteger poolsCount = [_poolNames count];
+        NSUInteger codeSize = bits / 8;
+        
+        // Sort the whole vocabulary by UTF-8 bytes and rank each token
+        NSMutableSet *vocabulary = [NSMutableSet set];
+        for (NSString *poolName in _poolNames) {
+            [vocabulary addObjectsFromArray:[[pools objectForKey:poolName] allTokens]];
+        }
+        
+        // Tokens without an UTF-8 form, holding a lone surrogate, can not be 
+        // looked up either and are left out
+        BKCompactToken *tokens = malloc(sizeof(BKCompactToken) * MAX([vocabulary count], 1u));
+        NSUInteger idx = 0;
+        for (NSString *token in vocabulary) {
+            const char *bytes = [token UTF8String];
+            if (bytes == NULL) continue;
+            tokens[idx].token = token;
+            tokens[idx].bytes = (const uint8_t*)bytes;
+            tokens[idx].length = strlen(bytes);
+            idx++;
+        }
+        _tokensCount = idx;
+        qsort(tokens, _tokensCount, sizeof(BKCompactToken), BKCompareCompactTokens);
+        
+        CFMutableDictionaryRef ranks = CFDictionaryCreateMutable(NULL, _tokensCount, 
+                                                                 &kCFTypeDictionaryKeyCallBacks, NULL);
+        for (idx = 0; idx < _tokensCount; idx++) {
+            CFDictionarySetValue(ranks, tokens[idx].token, (const void*)(uintptr_t)idx);
+        }
+        
+        // Lay out every token's cells, ordered by pool index
+        NSUInteger *cellsStarts = calloc(_tokensCount + 1, sizeof(NSUInteger));
+        NSMutableData *totals = [NSMutableData dataWithCapacity:poolsCount * sizeof(uint64_t)];
+        for (NSString *poolName in _poolNames) {
+            BKDataPool *pool = [pools objectForKey:poolName];
+            uint64_t total = CFSwapInt64HostToLittle([pool tokensTotalCount]);
+            [totals appendBytes:&total length:sizeof(total)];
+            
+            for (NSString *token in pool) {
+                const void *rank;
+                if (CFDictionaryGetValueIfPresent(ranks, token, &rank)) cellsStarts[(uintptr_t)rank + 1]++;
+            }
+        }
+        for (idx = 0; idx < _tokensCount; idx++) {
+            cellsStarts[idx + 1] += cellsStarts[idx];
+        }
+        
+        BKCompactCell *cells = malloc(sizeof(BKCompactCell) * MAX(cellsStarts[_tokensCount], 1u));
+        NSUInteger *cellsFilled = calloc(MAX(_tokensCount, 1u), sizeof(NSUInteger));
+        for (uint32_t poolIdx = 0; poolIdx < poolsCount; poolIdx++) {
+            BKDataPool *pool = [pools objectForKey:[_poolNames objectAtIndex:poolIdx]];
+            
+            for (NSString *token in pool) {
+                const void *value;
+                if (!CFDictionaryGetValueIfPresent(ranks, token, &value)) continue;
+                
+                NSUInteger rank = (uintptr_t)value;
+                BKCompactCell *cell = &cells[cellsStarts[rank] + cellsFilled[rank]++];
+                cell->pool = poolIdx;
+                cell->count = [pool countForToken:token];
+                cell->code = BKQuantizeProbability([pool probabilityForToken:token], bits);
+            }
+        }
+        free(cellsFilled);
+        CFRelease(ranks);
+        
+        // Front code the tokens by blocks, each token followed by its row
+        NSMutableData *entries = [NSMutableData data];
+        NSMutableData *offsets = [NSMutableData dataWithCapacity:
+                                  (_tokensCount / BKCompactBlockSize + 1) * sizeof(uint64_t)];
+        for (idx = 0; idx < _tokensCount; idx++) {
+            BKCompactToken *current = &tokens[idx];
+            
+            if (idx % BKCompactBlockSize == 0) {
+                uint64_t offset = CFSwapInt64HostToLittle([entries length]);
+                [offsets appendBytes:&offset length:sizeof(offset)];
+                BKAppendVarint(entries, current->length);
+                [entries appendBytes:current->bytes length:current->length];
+            } else {
+                BKCompactToken *previous = &tokens[idx - 1];
+                NSUInteger shared = BKCommonPrefixLength(previous->bytes, previous->length, 
+                                                         current->bytes, current->length);
+                BKAppendVarint(entries, shared);
+                BKAppendVarint(entries, current->length - shared);
+                [entries appendBytes:(current->bytes + shared) length:(current->length - shared)];
+            }
+            
+            BKAppendVarint(entries, cellsStarts[idx + 1] - cellsStarts[idx]);
+            uint32_t previousPool = 0;
+            for (NSUInteger c = cellsStarts[idx]; c < cellsStarts[idx + 1]; c++) {
+                uint8_t code[2] = {cells[c].code & 0xff, (cells[c].code >> 8) & 0xff};
+                BKAppendVarint(entries, cells[c].pool - previousPool);
+                BKAppendVarint(entries, cells[c].count);
+                [entries appendBytes:code length:codeSize];
+                previousPool = cells[c].pool;
+            }
+        }
+        free(cells);
+        free(cellsStarts);
+        free(tokens);
+        
+        _poolsTotalCounts = [totals copy];
+        _blocksOffsets = [offsets copy];
+        _entries = [entries copy];
+        [self buildDequantizationTable];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_dequantizationTable);
+    [_poolNames release];
+    [_poolsTotalCounts release];
+    [_blocksOffsets release];
+    [_entries release];
+    [super dealloc];
+}
+
+- (void)finalize
+{
+    free(_dequantizationTable);
+    [super finalize];
+}
+
+#pragma mark -
+#pragma mark NSCoding Methods
+- (id)initWithCoder:(NSCoder*)coder
+{
+    // The dequantization table is sized from the bits, a corrupted archive must not reach it
+    NSUInteger bits = [coder decodeIntegerForKey:@"QuantizationBits"];
+    if (bits != 8 && bits != 16) {
+        [self release];
+        @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                       reason:@"Probabilities can only be quantized on 8 or 16 bits" 
+                                     userInfo:nil];
+    }
+    
+    self = [super init];
+    if (self) {
+        _quantizationBits = bits;
+        _tokensCount = [coder decodeIntegerForKey:@"TokensCount"];
+        _poolNames = [[coder decodeObjectForKey:@"PoolNames"] retain];
+        _poolsTotalCounts = [[coder decodeObjectForKey:@"PoolsTotalCounts"] retain];
+        _blocksOffsets = [[coder decodeObjectForKey:@"BlocksOffsets"] retain];
+        _entries = [[coder decodeObjectForKey:@"Entries"] retain];
+        
+        // Lookups read the tables without bounds checks, they are walked once here
+        if (![self hasValidTables]) {
+            [self release];
+            @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                           reason:@"Not a valid compact model" 
+                                         userInfo:nil];
+        }
+        [self buildDequantizationTable];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder*)coder
+{
+    [coder encodeInteger:_quantizationBits forKey:@"QuantizationBits"];
+    [coder encodeInteger:_tokensCount forKey:@"TokensCount"];
+    [coder encodeObject:_poolNames forKey:@"PoolNames"];
+    [coder encodeObject:_poolsTotalCounts forKey:@"PoolsTotalCounts"];
+    [coder encodeObject:_blocksOffsets forKey:@"BlocksOffsets"];
+    [coder encodeObject:_entries forKey:@"Entries"];
+}
+
+#pragma mark -
+#pragma mark Token Data Methods
+- (NSUInteger)countForToken:(NSString*)token inPoolNamed:(NSString*)poolName
+{
+    NSUInteger poolIdx = [_poolNames indexOfObject:poolName];
+    const uint8_t *row = [self rowForToken:token];
+    if (poolIdx == NSNotFound || row == NULL) return 0;
+    
+    uint64_t cellsCount = BKReadVarint(&row);
+    NSUInteger pool = 0;
+    for (; cellsCount > 0; cellsCount--) {
+        pool += BKReadVarint(&row);
+        NSUInteger count = BKReadVarint(&row);
+        row += _quantizationBits / 8;
+        if (pool == poolIdx) return count;
+    }
+    return 0;
+}
+
+- (NSUInteger)tokensTotalCountForPoolNamed:(NSString*)poolName
+{
+    NSUInteger poolIdx = [_poolNames indexOfObject:poolName];
+    if (poolIdx == NSNotFound) return 0;
+    
+    const uint64_t *totals = [_poolsTotalCounts bytes];
+    return CFSwapInt64LittleToHost(totals[poolIdx]);
+}
+
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens
+{
+    return [self probabilitiesForTokens:tokens inPools:nil];
+}
+
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens inPools:(NSArray*)poolNames
+{
+    NSUInteger poolsCount = [_poolNames count];
+    NSUInteger codeSize = _quantizationBits / 8;
+    
+    const uint8_t *wanted = NULL;
+    if (poolNames) {
+        NSMutableData *mask = [NSMutableData dataWithLength:MAX(poolsCount, 1u)];
+        uint8_t *bytes = [mask mutableBytes];
+        for (NSString *poolName in poolNames) {
+            NSUInteger poolIdx = [_poolNames indexOfObject:poolName];
+            if (poolIdx != NSNotFound) bytes[poolIdx] = 1;
+        }
+        wanted = bytes;
+    }
+    
+    // Hits are gathered in buffers of the call, the model itself is never written
+    NSUInteger hitsCapacity = MAX([tokens count], 16u);
+    NSUInteger hitsCount = 0;
+    BKCompactHit *hits = malloc(sizeof(BKCompactHit) * hitsCapacity);
+    NSUInteger *poolsStarts = calloc(poolsCount + 1, sizeof(NSUInteger));
+    if (hits == NULL || poolsStarts == NULL) {
+        free(hits);
+        free(poolsStarts);
+        @throw [NSException exceptionWithName:NSMallocException 
+                                       reason:@"Unable to allocate the probabilities' buffers" 
+                                     userInfo:nil];
+    }
+    
+    for (NSString *token in tokens) {
+        const uint8_t *row = [self rowForToken:token];
+        if (row == NULL) continue;
+        
+        uint64_t cellsCount = BKReadVarint(&row);
+        uint32_t pool = 0;
+        for (; cellsCount > 0; cellsCount--) {
+            pool += (uint32_t)BKReadVarint(&row);
+            BKReadVarint(&row);
+            uint32_t code = BKReadCode(row, codeSize);
+            row += codeSize;
+            if (code == 0 || (wanted && !wanted[pool])) continue;
+            
+            if (hitsCount == hitsCapacity) {
+                BKCompactHit *grownHits = realloc(hits, sizeof(BKCompactHit) * hitsCapacity * 2);
+                if (grownHits == NULL) {
+                    free(hits);
+                    free(poolsStarts);
+                    @throw [NSException exceptionWithName:NSMallocException 
+                                                   reason:@"Unable to grow the probabilities' buffers" 
+                                                 userInfo:nil];
+                }
+                hits = grownHits;
+                hitsCapacity *= 2;
+            }
+            hits[hitsCount].pool = pool;
+            hits[hitsCount].probability = _dequantizationTable[code];
+            hitsCount++;
+            poolsStarts[pool + 1]++;
+        }
+    }
+    
+    // Bucket the probabilities by pool, then sort them like BKDataPool does
+    for (NSUInteger idx = 0; idx < poolsCount; idx++) {
+        poolsStarts[idx + 1] += poolsStarts[idx];
+    }
+    float *probabilities = malloc(sizeof(float) * MAX(hitsCount, 1u));
+    NSUInteger *poolsFilled = calloc(poolsCount + 1, sizeof(NSUInteger));
+    if (probabilities == NULL || poolsFilled == NULL) {
+        free(poolsFilled);
+        free(probabilities);
+        free(poolsStarts);
+        free(hits);
+        @throw [NSException exceptionWithName:NSMallocException 
+                                       reason:@"Unable to allocate the probabilities' buffers" 
+                                     userInfo:nil];
+    }
+    for (NSUInteger idx = 0; idx < hitsCount; idx++) {
+        uint32_t pool = hits[idx].pool;
+        probabilities[poolsStarts[pool] + poolsFilled[pool]++] = hits[idx].probability;
+    }
+    
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+    for (NSUInteger pool = 0; pool < poolsCount; pool++) {
+        NSUInteger start = poolsStarts[pool];
+        NSUInteger length = poolsStarts[pool + 1] - start;
+        if (length == 0) continue;
+        
+        qsort(probabilities + start, length, sizeof(float), BKCompareFloats);
+        NSMutableArray *poolProbabilities = [NSMutableArray arrayWithCapacity:length];
+        for (NSUInteger idx = start; idx < start + length; idx++) {
+            [poolProbabilities addObject:[NSNumber numberWithFloat:probabilities[idx]]];
+        }
+        [result setObject:poolProbabilities forKey:[_poolNames objectAtIndex:pool]];
+    }
+    
+    free(poolsFilled);
+    free(probabilities);
+    free(poolsStarts);
+    free(hits);
+    
+    return result;
+}
+
+#pragma mark -
+#pragma mark Printing Methods
+- (NSUInteger)sizeInBytes
+{
+    return [_entries length] + [_blocksOffsets length] + [_poolsTotalCounts length];
+}
+
+- (void)printInformations
+{
+    NSLog(@"Compact Model Informations:");
+    NSLog(@"         Number of tokens: %llu", (unsigned long long)_tokensCount);
+    NSLog(@"          Number of pools: %llu", (unsigned long long)[_poolNames count]);
+    NSLog(@"        Quantization bits: %llu", (unsigned long long)_quantizationBits);
+    NSLog(@"            Size in bytes: %llu", (unsigned long long)[self sizeInBytes]);
+    
+    for (NSString *poolName in _poolNames) {
+        NSLog(@"    %@ total count of tokens: %llu", poolName, 
+              (unsigned long long)[self tokensTotalCountForPoolNamed:poolName]);
+    }
+}
+
+#pragma mark -
+#pragma mark Private Methods
+- (void)buildDequantizationTable
+{
+    uint32_t levels = (1u << _quantizationBits) - 1;
+    float step = (2.f * BKCompactLogOddsLimit) / (float)(levels - 1);
+    
+    _dequantizationTable = malloc(sizeof(float) * (levels + 1));
+    _dequantizationTable[0] = 0.f;
+    for (uint32_t code = 1; code <= levels; code++) {
+        float logOdds = -BKCompactLogOddsLimit + (float)(code - 1) * step;
+        _dequantizationTable[code] = 1.f / (1.f + expf(-logOdds));
+    }
+}
+
+- (const uint8_t*)rowForToken:(NSString*)token
+{
+    NSUInteger blocksCount = [_blocksOffsets length] / sizeof(uint64_t);
+    if (blocksCount == 0) return NULL;
+    
+    const uint8_t *key = (const uint8_t*)[token UTF8String];
+    if (key == NULL) return NULL;
+    NSUInteger keyLength = strlen((const char*)key);
+    const uint8_t *entries = [_entries bytes];
+    const uint64_t *offsets = [_blocksOffsets bytes];
+    NSUInteger codeSize = _quantizationBits / 8;
+    
+    // Last block whose first token is lower than or equal to the key
+    NSUInteger low = 0, high = blocksCount;
+    while (high - low > 1) {
+        NSUInteger middle = (low + high) / 2;
+        const uint8_t *cursor = entries + CFSwapInt64LittleToHost(offsets[middle]);
+        NSUInteger length = BKReadVarint(&cursor);
+        if (BKCompareBytes(cursor, length, key, keyLength) <= 0) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    
+    const uint8_t *cursor = entries + CFSwapInt64LittleToHost(offsets[low]);
+    NSUInteger length = BKReadVarint(&cursor);
+    const uint8_t *bytes = cursor;
+    cursor += length;
+    
+    NSUInteger matched = BKCommonPrefixLength(bytes, length, key, keyLength);
+    if (matched == length && matched == keyLength) return cursor;
+    if (matched < length && (matched == keyLength || bytes[matched] > key[matched])) return NULL;
+    
+    // Walk the block keeping only the length of the prefix shared with the key, 
+    // every token decoded so far being lower than the key
+    NSUInteger remaining = MIN(BKCompactBlockSize, _tokensCount - low * BKCompactBlockSize) - 1;
+    for (; remaining > 0; remaining--) {
+        cursor = BKSkipRow(cursor, codeSize);
+        NSUInteger shared = BKReadVarint(&cursor);
+        NSUInteger suffixLength = BKReadVarint(&cursor);
+        const uint8_t *suffix = cursor;
+        cursor += suffixLength;
+        
+        if (shared > matched) continue;
+        if (shared < matched) return NULL;
+        
+        NSUInteger extra = BKCommonPrefixLength(suffix, suffixLength, key + matched, keyLength - matched);
+        matched += extra;
+        if (extra == suffixLength && matched == keyLength) return cursor;
+        if (extra < suffixLength && (matched == keyLength || suffix[extra] > key[matched])) return NULL;
+    }
+    
+    return NULL;
+}
+
+- (BOOL)hasValidTables
+{
+    if (![_poolNames isKindOfClass:[NSArray class]] || ![_poolsTotalCounts isKindOfClass:[NSData class]] ||
+        ![_blocksOffsets isKindOfClass:[NSData class]] || ![_entries isKindOfClass:[NSData class]]) return NO;
+    
+    // Every token takes at least two bytes of entries, which bounds the blocks' count
+    NSUInteger poolsCount = [_poolNames count];
+    if (_tokensCount > [_entries length] || [_poolsTotalCounts length] != poolsCount * sizeof(uint64_t)) return NO;
+    NSUInteger blocksCount = (_tokensCount + BKCompactBlockSize - 1) / BKCompactBlockSize;
+    if ([_blocksOffsets length] != blocksCount * sizeof(uint64_t)) return NO;
+    
+    const uint8_t *entries = [_entries bytes];
+    const uint8_t *end = entries + [_entries length];
+    const uint8_t *cursor = entries;
+    const uint64_t *offsets = [_blocksOffsets bytes];
+    NSUInteger codeSize = _quantizationBits / 8;
+    uint64_t previousLength = 0;
+    
+    for (NSUInteger idx = 0; idx < _tokensCount; idx++) {
+        uint64_t shared = 0, suffixLength, cellsCount, value;
+        
+        if (idx % BKCompactBlockSize == 0) {
+            if (CFSwapInt64LittleToHost(offsets[idx / BKCompactBlockSize]) != (uint64_t)(cursor - entries)) return NO;
+            if (!BKReadCheckedVarint(&cursor, end, &suffixLength)) return NO;
+        } else {
+            if (!BKReadCheckedVarint(&cursor, end, &shared) || shared > previousLength) return NO;
+            if (!BKReadCheckedVarint(&cursor, end, &suffixLength)) return NO;
+        }
+        if (suffixLength > (uint64_t)(end - cursor)) return NO;
+        cursor += suffixLength;
+        previousLength = shared + suffixLength;
+        
+        // Pools of a row are distinct and increasing, so their sum stays below the pools' count
+        if (!BKReadCheckedVarint(&cursor, end, &cellsCount) || cellsCount > poolsCount) return NO;
+        uint64_t pool = 0;
+        for (; cellsCount > 0; cellsCount--) {
+            if (!BKReadCheckedVarint(&cursor, end, &value) || value >= poolsCount) return NO;
+            pool += value;
+            if (pool >= poolsCount) return NO;
+            if (!BKReadCheckedVarint(&cursor, end, &value)) return NO;
+            if (codeSize > (NSUInteger)(end - cursor)) return NO;
+            cursor += codeSize;
+        }
+    }
+    return cursor == end;
+}
+
+@end
@@ -0,0 +1,144 @@
+//
+// BKCorpus.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Aggregated count of every token over a set of pools.
+ 
+ A corpus is not kept up to date by training: it is derived from the pools' 
+ counts when needed, in one pass over each pool. It keeps no copy of the tokens,
+ its rows retaining the pools' own strings, and no object per token: each token
+ is given a row and its count is stored in a plain column.
+ 
+ Saved files hold the corpus of the pools they were written with, so that it 
+ can be derived again by only swapping the counts of the pools decoded since.
+ 
+ Once derived it is only read, and can be read concurrently.
+ 
+ You should never have to handle an object of this class directly.
+ */
+@interface BKCorpus : NSObject <NSFastEnumeration, NSCoding> {
+    @private
+    NSUInteger _tokensTotalCount;
+    CFMutableDictionaryRef _rows;
+    NSMutableArray *_tokens;
+    NSUInteger *_counts;
+    NSUInteger _capacity;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Properties
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Sum of the counts of every token. */
+@property (readonly, getter=tokensTotalCount) NSUInteger _tokensTotalCount;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Initializing a corpus
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Initialize a corpus summing the counts of some pools.
+ 
+ @param pools An array of BKDataPool.
+ @return An initialized corpus.
+ */
+- (id)initWithPools:(NSArray*)pools;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Deriving a corpus
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Add the counts of a pool to the corpus.
+ 
+ @param pool The pool to add.
+ */
+- (void)addCountsOfPool:(BKDataPool*)pool;
+
+/** Subtract the counts of a pool previously added to the corpus.
+ 
+ Tokens whose count falls to 0 keep their row.
+ @param pool The pool to subtract, as it was when added.
+ */
+- (void)subtractCountsOfPool:(BKDataPool*)pool;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Reading tokens' count
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the number of occurences counted for a token over all the pools.
+ 
+ @param token The token to get the count from.
+ @return The number of occurences counted for the token. 0 if no token is found.
+ */
+- (NSUInteger)countForToken:(NSString*)token;
+
+/** Gathers the counts of several tokens into a column.
+ 
+ @param counts A C array of at least count elements, filled with the counts.
+ @param tokens A C array of the tokens to look up.
+ @param count The number of tokens.
+ */
+- (void)getCounts:(NSUInteger*)counts forTokens:(NSString**)tokens count:(NSUInteger)count;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Accessing tokens
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the number of distinct tokens in the corpus. */
+- (NSUInteger)tokensCount;
+
+/** Returns the tokens counted less than a given level, scanning the counts' column only.
+ 
+ @param level The minimum count of the tokens not returned.
+ @return An array of tokens.
+ */
+- (NSArray*)tokensCountedLessThan:(NSUInteger)level;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Print statistics
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Print some basics statistics on the receiver */
+- (void)printInformations;
+
+@end
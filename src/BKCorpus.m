@@ -0,0 +1,267 @@
+//
+// BKCorpus.m
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <BayesianKit/BKCorpus.h>
+#import <BayesianKit/BKDataPool.h>
+#import <BayesianKit/BKTokenData.h>
+
+@interface BKCorpus (Private)
+- (void)createRowsWithCapacity:(NSUInteger)capacity;
+- (void)addCount:(NSUInteger)count forToken:(NSString*)token;
+@end
+
+
+static NSData *BKArchiveColumn(const NSUInteger *column, NSUInteger length)
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length * sizeof(uint64_t)];
+    uint64_t *values = [data mutableBytes];
+    for (NSUInteger row = 0; row < length; row++) {
+        values[row] = CFSwapInt64HostToLittle(column[row]);
+    }
+    return data;
+}
+
+
+@implementation BKCorpus
+
+@synthesize _tokensTotalCount;
+
+- (id)init
+{
+    return [self initWithPools:[NSArray array]];
+}
+
+- (id)initWithPools:(NSArray*)pools
+{
+    self = [super init];
+    if (self) {
+        NSUInteger capacity = 0;
+        for (BKDataPool *pool in pools) {
+            capacity = MAX(capacity, [pool tokensCount]);
+        }
+        [self createRowsWithCapacity:capacity];
+        
+        for (BKDataPool *pool in pools) {
+            [self addCountsOfPool:pool];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_rows) CFRelease(_rows);
+    free(_counts);
+    [_tokens release];
+    [super dealloc];
+}
+
+- (void)finalize
+{
+    if (_rows) CFRelease(_rows);
+    free(_counts);
+    [super finalize];
+}
+
+#pragma mark -
+#pragma mark NSCoding Methods
+- (id)initWithCoder:(NSCoder*)coder
+{
+    self = [super init];
+    if (self) {
+        NSArray *tokens = [coder decodeObjectForKey:@"Tokens"];
+        NSData *counts = [coder decodeObjectForKey:@"Counts"];
+        NSUInteger rowsCount = [tokens count];
+        if (![tokens isKindOfClass:[NSArray class]] || [counts length] != rowsCount * sizeof(uint64_t)) {
+            [self release];
+            @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                           reason:@"Not a valid corpus" 
+                                         userInfo:nil];
+        }
+        
+        [self createRowsWithCapacity:rowsCount];
+        const uint64_t *values = [counts bytes];
+        for (NSUInteger row = 0; row < rowsCount; row++) {
+            [self addCount:(NSUInteger)CFSwapInt64LittleToHost(values[row]) forToken:[tokens objectAtIndex:row]];
+        }
+        _tokensTotalCount = [coder decodeIntegerForKey:@"TotalCount"];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder*)coder
+{
+    [coder encodeObject:_tokens forKey:@"Tokens"];
+    [coder encodeObject:BKArchiveColumn(_counts, [_tokens count]) forKey:@"Counts"];
+    [coder encodeInteger:_tokensTotalCount forKey:@"TotalCount"];
+}
+
+#pragma mark -
+#pragma mark Deriving Methods
+- (void)addCountsOfPool:(BKDataPool*)pool
+{
+    NSUInteger tokensCount = [pool tokensCount];
+    NSString **tokens = malloc(MAX(tokensCount, 1u) * sizeof(NSString*));
+    BKTokenData **tokensData = malloc(MAX(tokensCount, 1u) * sizeof(BKTokenData*));
+    
+    [pool getTokens:tokens tokensData:tokensData];
+    for (NSUInteger idx = 0; idx < tokensCount; idx++) {
+        [self addCount:[tokensData[idx] count] forToken:tokens[idx]];
+    }
+    _tokensTotalCount += [pool tokensTotalCount];
+    
+    free(tokens);
+    free(tokensData);
+}
+
+- (void)subtractCountsOfPool:(BKDataPool*)pool
+{
+    for (NSString *token in pool) {
+        const void *value;
+        if (!CFDictionaryGetValueIfPresent(_rows, token, &value)) continue;
+        
+        NSUInteger row = (uintptr_t)value;
+        _counts[row] -= MIN(_counts[row], [pool countForToken:token]);
+    }
+    _tokensTotalCount -= MIN(_tokensTotalCount, [pool tokensTotalCount]);
+}
+
+#pragma mark -
+#pragma mark Token Counting Methods
+- (NSUInteger)countForToken:(NSString*)token
+{
+    const void *row;
+    if (CFDictionaryGetValueIfPresent(_rows, token, &row)) {
+        return _counts[(uintptr_t)row];
+    } else {
+        return 0;
+    }
+}
+
+- (void)getCounts:(NSUInteger*)counts forTokens:(NSString**)tokens count:(NSUInteger)count
+{
+    for (NSUInteger idx = 0; idx < count; idx++) {
+        const void *row;
+        if (CFDictionaryGetValueIfPresent(_rows, tokens[idx], &row)) {
+            counts[idx] = _counts[(uintptr_t)row];
+        } else {
+            counts[idx] = 0;
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark General Token Manipulation
+- (NSUInteger)tokensCount
+{
+    return [_tokens count];
+}
+
+- (NSArray*)tokensCountedLessThan:(NSUInteger)level
+{
+    NSMutableArray *tokens = [NSMutableArray array];
+    NSUInteger rowsCount = [_tokens count];
+    
+    for (NSUInteger row = 0; row < rowsCount; row++) {
+        if (_counts[row] < level) [tokens addObject:[_tokens objectAtIndex:row]];
+    }
+    return tokens;
+}
+
+#pragma mark -
+#pragma mark Printing Methods
+- (void)printInformations
+{
+    NSUInteger rowsCount = [_tokens count];
+    NSUInteger mostCountedRow = 0;
+    for (NSUInteger row = 1; row < rowsCount; row++) {
+        if (_counts[row] > _counts[mostCountedRow]) mostCountedRow = row;
+    }
+    
+    NSLog(@"Corpus Informations:");
+    NSLog(@"         Number of tokens: %llu", (unsigned long long)rowsCount);
+    NSLog(@"    Total count of tokens: %llu", (unsigned long long)_tokensTotalCount);
+    if (rowsCount > 0) {
+        NSLog(@"       Most counted token: %@ counted %llu times", [_tokens objectAtIndex:mostCountedRow], 
+              (unsigned long long)_counts[mostCountedRow]);
+    }
+}
+
+#pragma mark -
+#pragma mark NSFastEnumeration Methods
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id *)stackbuf count:(NSUInteger)len
+{
+    return [_tokens countByEnumeratingWithState:state objects:stackbuf count:len];
+}
+
+#pragma mark -
+#pragma mark Private Methods
+- (void)createRowsWithCapacity:(NSUInteger)capacity
+{
+    _capacity = MAX(capacity, 16u);
+    // Keys are retained, not copied: the rows share the pools' strings
+    _rows = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, NULL);
+    _tokens = [[NSMutableArray alloc] initWithCapacity:_capacity];
+    _counts = malloc(_capacity * sizeof(NSUInteger));
+}
+
+- (void)addCount:(NSUInteger)count forToken:(NSString*)token
+{
+    const void *value;
+    
+    // One lookup per token and per pool, the row is appended on a miss
+    if (CFDictionaryGetValueIfPresent(_rows, token, &value)) {
+        _counts[(uintptr_t)value] += count;
+        return;
+    }
+    
+    NSUInteger row = [_tokens count];
+    if (row == _capacity) {
+        _capacity *= 2;
+        _counts = reallocf(_counts, _capacity * sizeof(NSUInteger));
+        if (_counts == NULL) {
+            @throw [NSException exceptionWithName:NSMallocException 
+                                           reason:@"Unable to grow the corpus' counts" 
+                                         userInfo:nil];
+        }
+    }
+    [_tokens addObject:token];
+    CFDictionarySetValue(_rows, token, (const void*)(uintptr_t)row);
+    _counts[row] = count;
+}
+
+@end
@@ -37,6 +37,8 @@
 
 #import <Foundation/Foundation.h>
 
+@class BKTokenData;
+
 /** Pool indexed by tokens and holding their data.
  
  You should never have to handle an object of this class directly.
@@ -47,6 +49,8 @@
     @private
     NSUInteger _tokensTotalCount;
     NSMutableDictionary *_tokensData;
+    NSUInteger _generation;
+    NSMutableDictionary *_removedTokens;
 }
 
 
@@ -59,6 +63,12 @@
 
 @property (readonly, getter=tokensTotalCount) NSUInteger _tokensTotalCount;
 
+/** Generation stamped on the tokens whose count is changed, and on the removed ones. 
+ 
+ It is not saved, the classifier sets it before changing the pool.
+ */
+@property (readwrite, assign, getter=generation, setter=setGeneration:) NSUInteger _generation;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Initialize a pool
@@ -136,6 +146,17 @@
  */
 - (NSArray*)probabilitiesForTokens:(NSArray*)tokens;
 
+/** Fills a buffer with the probabilities for a group of tokens.
+ 
+ Like @c probabilitiesForTokens:() but without allocating any object. The 
+ probabilities are written in the tokens' order and are @b not sorted.
+ @param probabilities A buffer able to hold at least as many floats as tokens.
+ @param tokens An array containing tokens.
+ @return The number of probabilities written in the buffer.
+ @see probabilitiesForTokens:
+ */
+- (NSUInteger)getProbabilities:(float*)probabilities forTokens:(NSArray*)tokens;
+
 /** Sets the probability associated with a token.
  
  Unlike @c setCount:forToken: This will @b not add the token to the pool.
@@ -151,10 +172,20 @@
 
 /** Remove a token from the pool and release any associated data.
  
+ The removal is always recorded for @c tokensRemovedSinceGeneration:().
  @param token The token to remove.
  */
 - (void)removeToken:(NSString*)token;
 
+/** Remove a token from the pool, only recording the removal if a checkpoint holds it.
+ 
+ A token counted after the latest checkpoint was never exported, so its removal 
+ is not recorded and leaves nothing behind.
+ @param token The token to remove.
+ @param checkpointGeneration The generation of the latest checkpoint.
+ */
+- (void)removeToken:(NSString*)token sinceCheckpoint:(NSUInteger)checkpointGeneration;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Accessing tokens
@@ -163,6 +194,44 @@
 /** Returns every token of the pool. */
 - (NSArray*)allTokens;
 
+/** Returns the number of distinct tokens in the pool. */
+- (NSUInteger)tokensCount;
+
+/** Copies the tokens and their data into two columns, in the same order.
+ 
+ @param tokens A C array of at least tokensCount objects, filled with the tokens.
+ @param tokensData A C array of at least tokensCount objects, filled with the tokens' data.
+ */
+- (void)getTokens:(NSString**)tokens tokensData:(BKTokenData**)tokensData;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Tracking changes
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the tokens whose count changed after a generation.
+ 
+ @param generation The generation to compare with.
+ @return A dictionary of the tokens' count, as NSNumber, keyed by token.
+ */
+- (NSDictionary*)countsChangedSinceGeneration:(NSUInteger)generation;
+
+/** Returns the tokens removed after a generation.
+ 
+ A token counted again since is in @c countsChangedSinceGeneration:() too, so 
+ its removal must be applied first. A removal which was not recorded is never 
+ returned.
+ @param generation The generation to compare with.
+ @return An array of tokens.
+ */
+- (NSArray*)tokensRemovedSinceGeneration:(NSUInteger)generation;
+
+/** Forget the tokens removed up to a generation included.
+ 
+ @param generation The last generation to forget.
+ */
+- (void)discardRemovedTokensUpToGeneration:(NSUInteger)generation;
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Print statistics
@@ -43,6 +43,7 @@
 
 @synthesize name;
 @synthesize _tokensTotalCount;
+@synthesize _generation;
 
 - (id)initWithName:(NSString*)aName
 {
@@ -58,6 +59,7 @@
 {
     [name release];
     [_tokensData release];
+    [_removedTokens release];
     [super dealloc];
 }
 
@@ -70,6 +72,7 @@
         name = [[coder decodeObjectForKey:@"Name"] retain];
         _tokensTotalCount = [coder decodeIntegerForKey:@"TotalCount"];
         _tokensData = [[coder decodeObjectForKey:@"TokensData"] retain];
+        _removedTokens = [[coder decodeObjectForKey:@"RemovedTokens"] mutableCopy];
     }
     return self;
 }
@@ -79,6 +82,7 @@
     [coder encodeObject:name forKey:@"Name"];
     [coder encodeInteger:_tokensTotalCount forKey:@"TotalCount"];
     [coder encodeObject:_tokensData forKey:@"TokensData"];
+    if ([_removedTokens count] > 0) [coder encodeObject:_removedTokens forKey:@"RemovedTokens"];
 }
 
 #pragma mark -
@@ -96,8 +100,9 @@
 - (void)setCount:(NSUInteger)count forToken:(NSString*)token
 {
     _tokensTotalCount -= [self countForToken:token];
-    [_tokensData setObject:[BKTokenData tokenDataWithCount:count] 
-                     forKey:token];
+    BKTokenData *data = [BKTokenData tokenDataWithCount:count];
+    [data setGeneration:_generation];
+    [_tokensData setObject:data forKey:token];
     _tokensTotalCount += count;
 }
 
@@ -114,15 +119,22 @@
         }
         data = [BKTokenData tokenDataWithCount:(count + [data count])];
     }
+    [data setGeneration:_generation];
     _tokensTotalCount+=count;
     [_tokensData setObject:data forKey:token];
 }
 
 - (void)increaseCountForToken:(NSString*)token
 {
-    NSUInteger count = [self countForToken:token];
-    [_tokensData setObject:[BKTokenData tokenDataWithCount:count+1]
-                     forKey:token];
+    BKTokenData *data = [_tokensData objectForKey:token];
+    if (data) {
+        [data increaseCount];
+    } else {
+        data = [[BKTokenData alloc] initWithCount:1];
+        [_tokensData setObject:data forKey:token];
+        [data release];
+    }
+    [data setGeneration:_generation];
     _tokensTotalCount++;
 }
 
@@ -161,6 +173,19 @@
     return probabilities;
 }
 
+- (NSUInteger)getProbabilities:(float*)probabilities forTokens:(NSArray*)tokens
+{
+    NSUInteger count = 0;
+    
+    for (NSString *token in tokens) {
+        BKTokenData *data = [_tokensData objectForKey:token];
+        if (data && [data probability] > 0) {
+            probabilities[count++] = [data probability];
+        }
+    }
+    return count;
+}
+
 #pragma mark -
 #pragma mark General Token Manipulation
 - (NSArray*)allTokens
@@ -168,12 +193,72 @@
     return [_tokensData allKeys];
 }
 
+- (NSUInteger)tokensCount
+{
+    return [_tokensData count];
+}
+
+- (void)getTokens:(NSString**)tokens tokensData:(BKTokenData**)tokensData
+{
+    [_tokensData getObjects:tokensData andKeys:tokens];
+}
+
 - (void)removeToken:(NSString*)token
 {
-    _tokensTotalCount -= [self countForToken:token];
+    [self removeToken:token sinceCheckpoint:NSUIntegerMax];
+}
+
+- (void)removeToken:(NSString*)token sinceCheckpoint:(NSUInteger)checkpointGeneration
+{
+    BKTokenData *data = [_tokensData objectForKey:token];
+    if (data == nil) return;
+    
+    // Only checkpoints taken after the token's last change hold it as it is
+    if ([data generation] <= checkpointGeneration) {
+        if (_removedTokens == nil) _removedTokens = [[NSMutableDictionary alloc] init];
+        [_removedTokens setObject:[NSNumber numberWithUnsignedInteger:_generation] forKey:token];
+    }
+    
+    _tokensTotalCount -= [data count];
     [_tokensData removeObjectForKey:token];
 }
 
+#pragma mark -
+#pragma mark Changes Tracking Methods
+- (NSDictionary*)countsChangedSinceGeneration:(NSUInteger)generation
+{
+    NSMutableDictionary *counts = [NSMutableDictionary dictionary];
+    
+    for (NSString *token in _tokensData) {
+        BKTokenData *data = [_tokensData objectForKey:token];
+        if ([data generation] > generation) {
+            [counts setObject:[NSNumber numberWithUnsignedInteger:[data count]] forKey:token];
+        }
+    }
+    return counts;
+}
+
+- (NSArray*)tokensRemovedSinceGeneration:(NSUInteger)generation
+{
+    NSMutableArray *tokens = [NSMutableArray array];
+    
+    for (NSString *token in _removedTokens) {
+        if ([[_removedTokens objectForKey:token] unsignedIntegerValue] > generation) {
+            [tokens addObject:token];
+        }
+    }
+    return tokens;
+}
+
+- (void)discardRemovedTokensUpToGeneration:(NSUInteger)generation
+{
+    for (NSString *token in [_removedTokens allKeys]) {
+        if ([[_removedTokens objectForKey:token] unsignedIntegerValue] <= generation) {
+            [_removedTokens removeObjectForKey:token];
+        }
+    }
+}
+
 
 #pragma mark -
 #pragma mark Printing Methods
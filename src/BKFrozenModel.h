@@ -0,0 +1,140 @@
+//
+// BKFrozenModel.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Read-only representation of a classifier's probabilities indexed by a 
+ minimal perfect hash.
+ 
+ Only the tokens holding a probability in at least one pool are kept. Each one
+ owns a slot made of a 32 bits fingerprint followed by its probability in every
+ pool, 0 meaning none. Tokens are spread in buckets of about 3 tokens, and each
+ bucket stores the seed sending all its tokens to distinct slots, or directly 
+ the slot of its only token. A lookup therefore costs one hash of the token, 
+ one read in the buckets and the read of a slot of 4 * (pools + 1) bytes, that is
+ about one cache line every 16 pools. The fingerprint, first word of the slot, 
+ discards tokens unknown to the model, but for one in 2^32.
+ 
+ The buckets and slots are archived as they are, loading a model does not 
+ rebuild the hash.
+ 
+ You should never have to handle an object of this class directly.
+ */
+@interface BKFrozenModel : NSObject <NSCoding> {
+    @private
+    NSArray *_poolNames;
+    NSDictionary *_poolIndices;
+    NSUInteger _tokensCount;
+    uint32_t _salt;
+    NSData *_displacements;
+    NSData *_slots;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Properties
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Number of tokens in the model. */
+@property (readonly, getter=tokensCount) NSUInteger _tokensCount;
+
+/** Names of the pools stored in the model, sorted alphabetically. */
+@property (readonly, getter=poolNames) NSArray *_poolNames;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Initializing a frozen model
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Initialize a frozen model from a group of data pools.
+ 
+ The pools' probabilities must be up to date, see 
+ @c BKClassifier::updatePoolsProbabilities().
+ @param pools A dictionary of @c BKDataPool indexed by their names.
+ @return An initialized frozen model.
+ @exception NSInvalidArgumentException if there are 2^31 tokens or more.
+ @exception NSInternalInconsistencyException if no perfect hash was found: 
+ each salt tried changes every token's hash, and is skipped as soon as two 
+ tokens' hashes collide.
+ */
+- (id)initWithPools:(NSDictionary*)pools;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Accessing tokens' probabilities
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the probability of a token in a pool.
+ 
+ @param token The token to get the probability from.
+ @param poolName The name of the pool.
+ @return The probability of the token. 0 if it has none.
+ */
+- (float)probabilityForToken:(NSString*)token inPoolNamed:(NSString*)poolName;
+
+/** Returns the probabilities for a group of tokens in every pools.
+ 
+ Behave like @c BKDataPool::probabilitiesForTokens:() for every pool at once.
+ Pools in which none of the tokens have a probability are not part of the result.
+ @param tokens An array containing tokens.
+ @return A dictionary with pools' names as keys and sorted arrays of NSNumber 
+ holding tokens probabilities as values.
+ */
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens;
+
+/** Returns the probabilities for a group of tokens in some pools.
+ 
+ Each token is looked up once, only the columns of the pools asked for are read.
+ @param tokens An array containing tokens.
+ @param poolNames The names of the pools to look into, nil meaning every pools.
+ @return A dictionary with pools' names as keys and sorted arrays of NSNumber 
+ holding tokens probabilities as values.
+ */
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens inPools:(NSArray*)poolNames;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Print statistics
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Returns the number of bytes used by the buckets and the slots. */
+- (NSUInteger)sizeInBytes;
+
+/** Print some basics statistics on the receiver */
+- (void)printInformations;
+
+@end
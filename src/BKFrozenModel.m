@@ -0,0 +1,473 @@
+//
+// BKFrozenModel.m
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <BayesianKit/BKFrozenModel.h>
+#import <BayesianKit/BKDataPool.h>
+#import "BKHashing.h"
+
+#define BKFrozenBucketSize 3
+#define BKFrozenMaxSeed (1u << 20)
+#define BKFrozenMaxSalts 8
+
+typedef union {
+    uint32_t fingerprint;
+    float probability;
+} BKFrozenWord;
+
+typedef struct {
+    uint32_t bucket;
+    uint32_t key;
+} BKFrozenKey;
+
+@interface BKFrozenModel (Private)
+- (const BKFrozenWord*)slotForToken:(NSString*)token;
+- (void)createPoolIndices;
+@end
+
+
+#pragma mark -
+#pragma mark Hashing Functions
+// The salt changes FNV's basis rather than its result, so that tokens colliding
+// under one salt are hashed apart under another. Salt 0 is plain BKHashString().
+static inline uint64_t BKHashToken(NSString *token, uint32_t salt)
+{
+    return BKMixHash(BKHashStringWithBasis(token, BKHashStringBasis ^ (salt * 0x9e3779b97f4a7c15ULL)));
+}
+
+static inline uint32_t BKFrozenBucket(uint64_t hash, uint32_t bucketsCount)
+{
+    return (uint32_t)(((hash & 0xffffffffULL) * bucketsCount) >> 32);
+}
+
+static inline uint32_t BKFrozenSlot(uint64_t hash, uint32_t seed, uint32_t slotsCount)
+{
+    return (uint32_t)(((BKMixHash(hash ^ (seed * 0x9e3779b97f4a7c15ULL)) >> 32) * slotsCount) >> 32);
+}
+
+
+#pragma mark -
+#pragma mark Building Functions
+static int BKCompareFrozenKeys(const void *a, const void *b)
+{
+    const BKFrozenKey *x = a;
+    const BKFrozenKey *y = b;
+    if (x->bucket != y->bucket) return (x->bucket < y->bucket) ? -1 : 1;
+    return (x->key < y->key) ? -1 : (x->key > y->key);
+}
+
+// Hash and displace: buckets are placed from the largest to the smallest, each
+// one looking for the first seed sending all its keys to free slots. Keys alone
+// in their bucket take the next free slot, stored as a negative displacement.
+static int BKCompareHashes(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+// No seed separates two keys of the same hash, they are found before placing any
+static BOOL BKHashesAreDistinct(const uint64_t *hashes, uint32_t keysCount)
+{
+    uint64_t *sorted = malloc(sizeof(uint64_t) * (keysCount + 1));
+    if (sorted == NULL) {
+        @throw [NSException exceptionWithName:NSMallocException 
+                                       reason:@"Unable to allocate the tokens' hashes" 
+                                     userInfo:nil];
+    }
+    memcpy(sorted, hashes, sizeof(uint64_t) * keysCount);
+    qsort(sorted, keysCount, sizeof(uint64_t), BKCompareHashes);
+    
+    BOOL distinct = YES;
+    for (uint32_t idx = 1; idx < keysCount && distinct; idx++) {
+        distinct = (sorted[idx] != sorted[idx - 1]);
+    }
+    free(sorted);
+    return distinct;
+}
+
+static BOOL BKPlaceKeys(const uint64_t *hashes, uint32_t keysCount, uint32_t bucketsCount,
+                        int32_t *displacements, uint32_t *slots)
+{
+    BKFrozenKey *keys = malloc(sizeof(BKFrozenKey) * (keysCount + 1));
+    uint32_t *starts = calloc(bucketsCount + 1, sizeof(uint32_t));
+    uint32_t *order = malloc(sizeof(uint32_t) * (bucketsCount + 1));
+    uint32_t *sizes = calloc(keysCount + 2, sizeof(uint32_t));
+    uint8_t *taken = calloc(keysCount + 1, 1);
+    BOOL placed = YES;
+    
+    for (uint32_t idx = 0; idx < keysCount; idx++) {
+        keys[idx].bucket = BKFrozenBucket(hashes[idx], bucketsCount);
+        keys[idx].key = idx;
+    }
+    qsort(keys, keysCount, sizeof(BKFrozenKey), BKCompareFrozenKeys);
+    for (uint32_t idx = 0; idx < keysCount; idx++) starts[keys[idx].bucket + 1]++;
+    for (uint32_t bucket = 0; bucket < bucketsCount; bucket++) starts[bucket + 1] += starts[bucket];
+    
+    // Counting sort of the buckets by decreasing size
+    for (uint32_t bucket = 0; bucket < bucketsCount; bucket++) {
+        sizes[starts[bucket + 1] - starts[bucket]]++;
+    }
+    for (uint32_t size = keysCount, position = 0; ; size--) {
+        uint32_t count = sizes[size];
+        sizes[size] = position;
+        position += count;
+        if (size == 0) break;
+    }
+    for (uint32_t bucket = 0; bucket < bucketsCount; bucket++) {
+        order[sizes[starts[bucket + 1] - starts[bucket]]++] = bucket;
+    }
+    
+    uint32_t freeSlot = 0;
+    for (uint32_t rank = 0; rank < bucketsCount && placed; rank++) {
+        uint32_t bucket = order[rank];
+        uint32_t start = starts[bucket], end = starts[bucket + 1];
+        
+        if (end == start) break;
+        if (end - start == 1) {
+            while (taken[freeSlot]) freeSlot++;
+            taken[freeSlot] = 1;
+            slots[keys[start].key] = freeSlot;
+            displacements[bucket] = -(int32_t)freeSlot - 1;
+            continue;
+        }
+        
+        placed = NO;
+        for (uint32_t seed = 1; seed < BKFrozenMaxSeed && !placed; seed++) {
+            uint32_t idx = start;
+            for (; idx < end; idx++) {
+                uint32_t slot = BKFrozenSlot(hashes[keys[idx].key], seed, keysCount);
+                if (taken[slot]) break;
+                taken[slot] = 1;
+                slots[keys[idx].key] = slot;
+            }
+            if (idx == end) {
+                displacements[bucket] = (int32_t)seed;
+                placed = YES;
+            } else {
+                while (idx-- > start) taken[slots[keys[idx].key]] = 0;
+            }
+        }
+    }
+    
+    free(taken);
+    free(sizes);
+    free(order);
+    free(starts);
+    free(keys);
+    return placed;
+}
+
+// Buckets and slots are archived as little endian 32 bits words
+static NSData *BKSwapWordsIfBigEndian(NSData *data)
+{
+#if __BIG_ENDIAN__
+    NSMutableData *swapped = [NSMutableData dataWithData:data];
+    uint32_t *words = [swapped mutableBytes];
+    for (NSUInteger idx = 0; idx < [swapped length] / sizeof(uint32_t); idx++) {
+        words[idx] = CFSwapInt32(words[idx]);
+    }
+    return swapped;
+#else
+    return data;
+#endif
+}
+
+
+@implementation BKFrozenModel
+
+@synthesize _tokensCount;
+@synthesize _poolNames;
+
+- (id)initWithPools:(NSDictionary*)pools
+{
+    self = [super init];
+    if (self) {
+        _poolNames = [[[pools allKeys] sortedArrayUsingSelector:@selector(compare:)] retain];
+        NSUInteger poolsCount = [_poolNames count];
+        [self createPoolIndices];
+        
+        // Tokens without any probability never take part in a guess
+        NSMutableSet *vocabulary = [NSMutableSet set];
+        for (NSString *poolName in _poolNames) {
+            BKDataPool *pool = [pools objectForKey:poolName];
+            for (NSString *token in pool) {
+                if ([pool probabilityForToken:token] > 0.f) [vocabulary addObject:token];
+            }
+        }
+        if ([vocabulary count] >= INT32_MAX) {
+            [self release];
+            @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                           reason:@"Too much tokens to be frozen" 
+                                         userInfo:nil];
+        }
+        
+        NSArray *tokens = [vocabulary allObjects];
+        uint32_t keysCount = (uint32_t)[tokens count];
+        uint32_t bucketsCount = keysCount / BKFrozenBucketSize + 1;
+        uint64_t *hashes = malloc(sizeof(uint64_t) * (keysCount + 1));
+        uint32_t *slots = malloc(sizeof(uint32_t) * (keysCount + 1));
+        NSMutableData *displacements = [NSMutableData dataWithLength:bucketsCount * sizeof(int32_t)];
+        _tokensCount = keysCount;
+        
+        // Another salt is only needed if two tokens' hashes collide, which is 
+        // checked before looking for seeds, or if no seed places a bucket
+        BOOL placed = NO;
+        for (uint32_t salt = 0; salt < BKFrozenMaxSalts && !placed; salt++) {
+            for (uint32_t idx = 0; idx < keysCount; idx++) {
+                hashes[idx] = BKHashToken([tokens objectAtIndex:idx], salt);
+            }
+            if (!BKHashesAreDistinct(hashes, keysCount)) continue;
+            
+            memset([displacements mutableBytes], 0, [displacements length]);
+            placed = BKPlaceKeys(hashes, keysCount, bucketsCount, [displacements mutableBytes], slots);
+            _salt = salt;
+        }
+        if (!placed) {
+            free(slots);
+            free(hashes);
+            [self release];
+            @throw [NSException exceptionWithName:NSInternalInconsistencyException 
+                                           reason:@"Unable to build a perfect hash of the tokens" 
+                                         userInfo:nil];
+        }
+        
+        // A slot is the token's fingerprint followed by its probability in each pool
+        NSUInteger stride = poolsCount + 1;
+        NSMutableData *slotsData = [NSMutableData dataWithLength:keysCount * stride * sizeof(BKFrozenWord)];
+        BKFrozenWord *words = [slotsData mutableBytes];
+        for (uint32_t idx = 0; idx < keysCount; idx++) {
+            NSString *token = [tokens objectAtIndex:idx];
+            BKFrozenWord *slot = words + slots[idx] * stride;
+            
+            slot[0].fingerprint = (uint32_t)(hashes[idx] >> 32);
+            for (NSUInteger poolIdx = 0; poolIdx < poolsCount; poolIdx++) {
+                BKDataPool *pool = [pools objectForKey:[_poolNames objectAtIndex:poolIdx]];
+                slot[poolIdx + 1].probability = [pool probabilityForToken:token];
+            }
+        }
+        free(slots);
+        free(hashes);
+        
+        _displacements = [displacements copy];
+        _slots = [slotsData copy];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_poolNames release];
+    [_poolIndices release];
+    [_displacements release];
+    [_slots release];
+    [super dealloc];
+}
+
+#pragma mark -
+#pragma mark NSCoding Methods
+- (id)initWithCoder:(NSCoder*)coder
+{
+    self = [super init];
+    if (self) {
+        _tokensCount = [coder decodeIntegerForKey:@"TokensCount"];
+        _salt = (uint32_t)[coder decodeInt32ForKey:@"Salt"];
+        _poolNames = [[coder decodeObjectForKey:@"PoolNames"] retain];
+        _displacements = [BKSwapWordsIfBigEndian([coder decodeObjectForKey:@"Displacements"]) retain];
+        _slots = [BKSwapWordsIfBigEndian([coder decodeObjectForKey:@"Slots"]) retain];
+        
+        // Lookups index both tables without bounds checks, their sizes are checked once here
+        NSUInteger bucketsCount = _tokensCount / BKFrozenBucketSize + 1;
+        BOOL valid = (_tokensCount < INT32_MAX && [_poolNames isKindOfClass:[NSArray class]] &&
+                      [_displacements length] == bucketsCount * sizeof(int32_t) &&
+                      [_slots length] == _tokensCount * ([_poolNames count] + 1) * sizeof(BKFrozenWord));
+        const int32_t *displacements = [_displacements bytes];
+        for (NSUInteger bucket = 0; valid && bucket < bucketsCount; bucket++) {
+            if (displacements[bucket] < 0) valid = ((NSUInteger)(-(displacements[bucket] + 1)) < _tokensCount);
+        }
+        if (!valid) {
+            [self release];
+            @throw [NSException exceptionWithName:NSInvalidArgumentException 
+                                           reason:@"Not a valid frozen model" 
+                                         userInfo:nil];
+        }
+        [self createPoolIndices];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder*)coder
+{
+    [coder encodeInteger:_tokensCount forKey:@"TokensCount"];
+    [coder encodeInt32:(int32_t)_salt forKey:@"Salt"];
+    [coder encodeObject:_poolNames forKey:@"PoolNames"];
+    [coder encodeObject:BKSwapWordsIfBigEndian(_displacements) forKey:@"Displacements"];
+    [coder encodeObject:BKSwapWordsIfBigEndian(_slots) forKey:@"Slots"];
+}
+
+#pragma mark -
+#pragma mark Token Probabilities Methods
+- (float)probabilityForToken:(NSString*)token inPoolNamed:(NSString*)poolName
+{
+    NSNumber *poolIdx = [_poolIndices objectForKey:poolName];
+    const BKFrozenWord *slot = [self slotForToken:token];
+    if (poolIdx == nil || slot == NULL) return 0.f;
+    
+    return slot[[poolIdx unsignedIntegerValue] + 1].probability;
+}
+
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens
+{
+    return [self probabilitiesForTokens:tokens inPools:nil];
+}
+
+- (NSDictionary*)probabilitiesForTokens:(NSArray*)tokens inPools:(NSArray*)poolNames
+{
+    if (poolNames == nil) poolNames = _poolNames;
+    
+    // Pools asked for are resolved once, the columns to read follow their order
+    NSUInteger wantedCount = 0;
+    NSUInteger *wanted = malloc(sizeof(NSUInteger) * MAX([poolNames count], 1u));
+    NSString **wantedNames = malloc(sizeof(NSString*) * MAX([poolNames count], 1u));
+    if (wanted == NULL || wantedNames == NULL) {
+        free(wantedNames);
+        free(wanted);
+        @throw [NSException exceptionWithName:NSMallocException 
+                                       reason:@"Unable to allocate the probabilities' buffers" 
+                                     userInfo:nil];
+    }
+    for (NSString *poolName in poolNames) {
+        NSNumber *poolIdx = [_poolIndices objectForKey:poolName];
+        if (poolIdx == nil) continue;
+        
+        wanted[wantedCount] = [poolIdx unsignedIntegerValue];
+        wantedNames[wantedCount] = poolName;
+        wantedCount++;
+    }
+    
+    // Each token's slot is read once and scattered into a buffer per pool, 
+    // gathered on the call's own heap
+    NSUInteger tokensCount = MAX([tokens count], 1u);
+    float *probabilities = malloc(sizeof(float) * tokensCount * MAX(wantedCount, 1u));
+    NSUInteger *counts = calloc(MAX(wantedCount, 1u), sizeof(NSUInteger));
+    if (probabilities == NULL || counts == NULL) {
+        free(counts);
+        free(probabilities);
+        free(wantedNames);
+        free(wanted);
+        @throw [NSException exceptionWithName:NSMallocException 
+                                       reason:@"Unable to allocate the probabilities' buffers" 
+                                     userInfo:nil];
+    }
+    for (NSString *token in tokens) {
+        const BKFrozenWord *slot = [self slotForToken:token];
+        if (slot == NULL) continue;
+        
+        for (NSUInteger idx = 0; idx < wantedCount; idx++) {
+            float probability = slot[wanted[idx] + 1].probability;
+            if (probability > 0.f) probabilities[idx * tokensCount + counts[idx]++] = probability;
+        }
+    }
+    
+    NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity:wantedCount];
+    for (NSUInteger idx = 0; idx < wantedCount; idx++) {
+        NSUInteger count = counts[idx];
+        if (count == 0) continue;
+        
+        float *poolBuffer = probabilities + idx * tokensCount;
+        qsort(poolBuffer, count, sizeof(float), BKCompareFloats);
+        NSMutableArray *poolProbabilities = [NSMutableArray arrayWithCapacity:count];
+        for (NSUInteger hit = 0; hit < count; hit++) {
+            [poolProbabilities addObject:[NSNumber numberWithFloat:poolBuffer[hit]]];
+        }
+        [result setObject:poolProbabilities forKey:wantedNames[idx]];
+    }
+    
+    free(counts);
+    free(probabilities);
+    free(wantedNames);
+    free(wanted);
+    return result;
+}
+
+#pragma mark -
+#pragma mark Printing Methods
+- (NSUInteger)sizeInBytes
+{
+    return [_displacements length] + [_slots length];
+}
+
+- (void)printInformations
+{
+    NSLog(@"Frozen Model Informations:");
+    NSLog(@"         Number of tokens: %llu", (unsigned long long)_tokensCount);
+    NSLog(@"          Number of pools: %llu", (unsigned long long)[_poolNames count]);
+    NSLog(@"        Number of buckets: %llu", (unsigned long long)([_displacements length] / sizeof(int32_t)));
+    NSLog(@"            Size in bytes: %llu", (unsigned long long)[self sizeInBytes]);
+}
+
+#pragma mark -
+#pragma mark Private Methods
+- (void)createPoolIndices
+{
+    NSMutableDictionary *poolIndices = [NSMutableDictionary dictionaryWithCapacity:[_poolNames count]];
+    for (NSUInteger poolIdx = 0; poolIdx < [_poolNames count]; poolIdx++) {
+        [poolIndices setObject:[NSNumber numberWithUnsignedInteger:poolIdx] forKey:[_poolNames objectAtIndex:poolIdx]];
+    }
+    _poolIndices = [poolIndices copy];
+}
+
+- (const BKFrozenWord*)slotForToken:(NSString*)token
+{
+    if (_tokensCount == 0) return NULL;
+    
+    uint64_t hash = BKHashToken(token, _salt);
+    const int32_t *displacements = [_displacements bytes];
+    int32_t displacement = displacements[BKFrozenBucket(hash, (uint32_t)([_displacements length] / sizeof(int32_t)))];
+    if (displacement == 0) return NULL;
+    
+    uint32_t slot;
+    if (displacement < 0) {
+        slot = (uint32_t)(-(displacement + 1));
+    } else {
+        slot = BKFrozenSlot(hash, (uint32_t)displacement, (uint32_t)_tokensCount);
+    }
+    
+    const BKFrozenWord *words = (const BKFrozenWord*)[_slots bytes] + slot * ([_poolNames count] + 1);
+    return (words[0].fingerprint == (uint32_t)(hash >> 32)) ? words : NULL;
+}
+
+@end
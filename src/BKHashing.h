@@ -0,0 +1,85 @@
+//
+// BKHashing.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+// Helpers shared by the framework's implementation, this header is not public.
+
+// Finalizer of MurmurHash3, every bit of the input spreads over the whole hash
+static inline uint64_t BKMixHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+#define BKHashStringBasis 14695981039346656037ULL
+
+// FNV-1a of the UTF-16 characters of a string, started from a given basis. 
+// Strings colliding from one basis do not from another.
+static inline uint64_t BKHashStringWithBasis(NSString *string, uint64_t basis)
+{
+    CFStringInlineBuffer buffer;
+    CFIndex length = CFStringGetLength((CFStringRef)string);
+    uint64_t hash = basis;
+    
+    CFStringInitInlineBuffer((CFStringRef)string, &buffer, CFRangeMake(0, length));
+    for (CFIndex idx = 0; idx < length; idx++) {
+        hash ^= CFStringGetCharacterFromInlineBuffer(&buffer, idx);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// FNV-1a of the UTF-16 characters of a string. Unlike -hash it is stable across
+// runs and Foundation versions, checksums and frozen models are archived with it.
+static inline uint64_t BKHashString(NSString *string)
+{
+    return BKHashStringWithBasis(string, BKHashStringBasis);
+}
+
+// Sorts probabilities in ascending order with qsort
+static inline int BKCompareFloats(const void *a, const void *b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    if (x < y) return -1;
+    return (x > y) ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+//
+// BKProbabilities.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Probabilities computation shared by the framework's implementation, this 
+// header is not public. It is plain C so that tools/ProbabilityCheck.c checks 
+// the very code the classifier runs.
+
+#define BKNotSignificant -1.f
+
+static inline float BKMinOne(float x)
+{
+    return (1.f < x) ? 1.f : x;
+}
+
+// Same operations, in the same order, as the original per token computation
+static inline float BKTokenProbability(float poolCount, float deltaCount, 
+                                       float poolTotal, float deltaTotal, int emptyPool)
+{
+    float goodMetric;
+    if (emptyPool) {
+        goodMetric = 1.f;
+    } else {
+        goodMetric = BKMinOne(deltaCount/poolTotal);
+    }
+    float badMetric = BKMinOne(poolCount/deltaTotal);
+    float f = badMetric / (goodMetric + badMetric);
+    
+    return (fabs(f - 0.5f) >= 0.1) ? f : BKNotSignificant;
+}
+
+// No float lies in [0.1, 0.1f), so |d| >= 0.1f is the significance cut of the 
+// scalar code, and _mm_min_ps(one, x) is exactly BKMinOne(x).
+static inline void BKComputeProbabilities(const float *poolCounts, const float *deltaCounts, size_t count,
+                                          float poolTotal, float deltaTotal, int emptyPool, float *probabilities)
+{
+    size_t idx = 0;
+    
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 cut = _mm_set1_ps(0.1f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 notSignificant = _mm_set1_ps(BKNotSignificant);
+    const __m128 poolTotals = _mm_set1_ps(poolTotal);
+    const __m128 deltaTotals = _mm_set1_ps(deltaTotal);
+    
+    for (; idx + 4 <= count; idx += 4) {
+        __m128 goodMetric = emptyPool ? one : _mm_min_ps(one, _mm_div_ps(_mm_loadu_ps(deltaCounts + idx), poolTotals));
+        __m128 badMetric = _mm_min_ps(one, _mm_div_ps(_mm_loadu_ps(poolCounts + idx), deltaTotals));
+        __m128 f = _mm_div_ps(badMetric, _mm_add_ps(goodMetric, badMetric));
+        __m128 significant = _mm_cmpge_ps(_mm_and_ps(_mm_sub_ps(f, half), absMask), cut);
+        _mm_storeu_ps(probabilities + idx, _mm_or_ps(_mm_and_ps(significant, f), 
+                                                     _mm_andnot_ps(significant, notSignificant)));
+    }
+#endif
+    
+    for (; idx < count; idx++) {
+        probabilities[idx] = BKTokenProbability(poolCounts[idx], deltaCounts[idx], 
+                                                poolTotal, deltaTotal, emptyPool);
+    }
+}
@@ -0,0 +1,167 @@
+//
+// BKResultCache.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Signature of a group of tokens, as computed by @c BKResultCache. */
+typedef struct {
+    /** Order independent hash of the tokens and of the pools asked for. */
+    uint64_t hash;
+    /** SimHash of the tokens, only computed when near-duplicates are looked for. */
+    uint64_t simHash;
+} BKTokensSignature;
+
+@class BKResultCacheEntry;
+
+/** Bounded LRU cache of guesses' results.
+ 
+ Results are indexed by an order independent hash of the tokens they were 
+ computed on and of the pools that were asked for. When @c maximumDistance is 
+ not 0, a SimHash of the tokens is also kept for each result so that a 
+ near-duplicate, whose SimHash differs by at most @c maximumDistance bits, can 
+ reuse it. SimHashes are cut in @c maximumDistance + 1 bands and indexed by 
+ band, a near-duplicate sharing at least one of them, so that only the results 
+ with a band in common are compared.
+ 
+ A lookup relinks the LRU list and counts hits, so every method but computing 
+ a signature holds a lock on the cache, which concurrent guesses share.
+ 
+ You should never have to handle an object of this class directly, see 
+ @c BKClassifier::resultCacheCapacity.
+ */
+@interface BKResultCache : NSObject {
+    @private
+    NSUInteger _capacity;
+    NSUInteger _maximumDistance;
+    NSMutableDictionary *_entries;
+    NSMutableDictionary *_bands;
+    BKResultCacheEntry *_mostRecent;
+    BKResultCacheEntry *_leastRecent;
+    
+    NSUInteger _hits;
+    NSUInteger _nearHits;
+    NSUInteger _misses;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Properties
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Maximum number of results kept. */
+@property (readonly, getter=capacity) NSUInteger _capacity;
+
+/** Maximum number of differing SimHash bits for a near-duplicate, 0 to disable. */
+@property (readwrite, assign, getter=maximumDistance, setter=setMaximumDistance:) NSUInteger _maximumDistance;
+
+/** Number of lookups answered by an exact match. */
+@property (readonly, getter=hits) NSUInteger _hits;
+
+/** Number of lookups answered by a near-duplicate. */
+@property (readonly, getter=nearHits) NSUInteger _nearHits;
+
+/** Number of lookups left unanswered. */
+@property (readonly, getter=misses) NSUInteger _misses;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Initializing a cache
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Initialize a result cache.
+ 
+ @param capacity The maximum number of results kept.
+ @return An initialized result cache.
+ */
+- (id)initWithCapacity:(NSUInteger)capacity;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Caching results
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Compute the signature of a group of tokens guessed against some pools.
+ 
+ @param tokens An array containing tokens.
+ @param poolNames The names of the pools asked for, nil meaning every pools.
+ @return The signature to look results up with.
+ */
+- (BKTokensSignature)signatureForTokens:(NSArray*)tokens inPools:(NSArray*)poolNames;
+
+/** Returns the result cached for a signature.
+ 
+ @param signature The signature of the tokens.
+ @param poolNames The names of the pools asked for, nil meaning every pools.
+ @return The result cached, or nil if neither the signature nor a near-duplicate 
+ was found.
+ */
+- (NSDictionary*)resultForSignature:(BKTokensSignature)signature inPools:(NSArray*)poolNames;
+
+/** Cache a result, evicting the least recently used one when full.
+ 
+ @param result The result of a guess.
+ @param signature The signature of the tokens.
+ @param poolNames The names of the pools asked for, nil meaning every pools.
+ */
+- (void)setResult:(NSDictionary*)result forSignature:(BKTokensSignature)signature inPools:(NSArray*)poolNames;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Invalidating results
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Remove every result which involved a given pool.
+ 
+ @param poolName The name of the pool.
+ */
+- (void)removeResultsForPoolNamed:(NSString*)poolName;
+
+/** Remove every result. */
+- (void)removeAllResults;
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Print statistics
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Ratio of lookups answered, either by an exact match or a near-duplicate. */
+- (float)hitRate;
+
+/** Print some basics statistics on the receiver */
+- (void)printInformations;
+
+@end
@@ -0,0 +1,346 @@
+//
+// BKResultCache.m
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <BayesianKit/BKResultCache.h>
+#import "BKHashing.h"
+
+/** Node of the LRU list, retained by the cache's dictionary and bands' buckets only. */
+@interface BKResultCacheEntry : NSObject {
+    @public
+    NSNumber *key;
+    uint64_t simHash;
+    NSSet *poolNames;
+    NSDictionary *result;
+    BKResultCacheEntry *previous;
+    BKResultCacheEntry *next;
+}
+@end
+
+@implementation BKResultCacheEntry
+
+- (void)dealloc
+{
+    [key release];
+    [poolNames release];
+    [result release];
+    [super dealloc];
+}
+
+@end
+
+
+@interface BKResultCache (Private)
+- (void)detachEntry:(BKResultCacheEntry*)entry;
+- (void)attachEntry:(BKResultCacheEntry*)entry;
+- (void)removeEntry:(BKResultCacheEntry*)entry;
+- (void)indexEntry:(BKResultCacheEntry*)entry;
+- (void)unindexEntry:(BKResultCacheEntry*)entry;
+@end
+
+
+#pragma mark -
+#pragma mark Hashing Functions
+// Pigeonhole: SimHashes within d bits of each other share one of d + 1 bands
+static inline NSUInteger BKBandsCount(NSUInteger maximumDistance)
+{
+    return MIN(maximumDistance + 1, 64u);
+}
+
+static inline NSNumber *BKBandKey(uint64_t simHash, NSUInteger band, NSUInteger bandsCount)
+{
+    NSUInteger start = band * 64 / bandsCount;
+    NSUInteger width = (band + 1) * 64 / bandsCount - start;
+    uint64_t value = (simHash >> start) & ((1ULL << width) - 1);
+    return [NSNumber numberWithUnsignedLongLong:((uint64_t)band << 32) | value];
+}
+
+static inline BOOL BKSamePools(NSSet *a, NSSet *b)
+{
+    if (a == nil || b == nil) return a == b;
+    return [a isEqualToSet:b];
+}
+
+
+@implementation BKResultCache
+
+@synthesize _capacity;
+@synthesize _hits;
+@synthesize _nearHits;
+@synthesize _misses;
+
+- (id)initWithCapacity:(NSUInteger)capacity
+{
+    self = [super init];
+    if (self) {
+        _capacity = capacity;
+        _entries = [[NSMutableDictionary alloc] initWithCapacity:capacity];
+        _bands = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [_entries release];
+    [_bands release];
+    [super dealloc];
+}
+
+#pragma mark -
+#pragma mark Properties Methods
+- (NSUInteger)maximumDistance
+{
+    return _maximumDistance;
+}
+
+- (void)setMaximumDistance:(NSUInteger)distance
+{
+    @synchronized(self) {
+        // Bands depend on the distance, entries are indexed again
+        _maximumDistance = distance;
+        [_bands removeAllObjects];
+        for (BKResultCacheEntry *entry = _mostRecent; entry; entry = entry->next) {
+            [self indexEntry:entry];
+        }
+    }
+}
+
+#pragma mark -
+#pragma mark Caching Methods
+- (BKTokensSignature)signatureForTokens:(NSArray*)tokens inPools:(NSArray*)poolNames
+{
+    BKTokensSignature signature = {0, 0};
+    int32_t votes[64] = {0};
+    
+    // Sums are order independent and keep duplicated tokens, as guesses do
+    for (NSString *token in tokens) {
+        uint64_t hash = BKMixHash(BKHashString(token));
+        signature.hash += hash;
+        
+        if (_maximumDistance > 0) {
+            for (NSUInteger bit = 0; bit < 64; bit++) {
+                votes[bit] += ((hash >> bit) & 1) ? 1 : -1;
+            }
+        }
+    }
+    for (NSUInteger bit = 0; bit < 64; bit++) {
+        if (votes[bit] > 0) signature.simHash |= (1ULL << bit);
+    }
+    
+    signature.hash = BKMixHash(signature.hash ^ (uint64_t)[tokens count]);
+    if (poolNames) {
+        uint64_t poolsHash = 0;
+        for (NSString *poolName in [NSSet setWithArray:poolNames]) {
+            poolsHash += BKMixHash(BKHashString(poolName));
+        }
+        signature.hash = BKMixHash(signature.hash ^ poolsHash);
+    }
+    
+    return signature;
+}
+
+- (NSDictionary*)resultForSignature:(BKTokensSignature)signature inPools:(NSArray*)poolNames
+{
+    @synchronized(self) {
+        NSNumber *key = [NSNumber numberWithUnsignedLongLong:signature.hash];
+        BKResultCacheEntry *entry = [_entries objectForKey:key];
+        NSSet *pools = poolNames ? [NSSet setWithArray:poolNames] : nil;
+        
+        if (entry && BKSamePools(entry->poolNames, pools)) {
+            _hits++;
+        } else if (_maximumDistance > 0) {
+            // Only the results sharing a band with the signature are compared
+            NSUInteger bandsCount = BKBandsCount(_maximumDistance);
+            entry = nil;
+            for (NSUInteger band = 0; band < bandsCount && entry == nil; band++) {
+                NSArray *candidates = [_bands objectForKey:BKBandKey(signature.simHash, band, bandsCount)];
+                for (BKResultCacheEntry *candidate in candidates) {
+                    NSUInteger distance = __builtin_popcountll(candidate->simHash ^ signature.simHash);
+                    if (distance <= _maximumDistance && BKSamePools(candidate->poolNames, pools)) {
+                        entry = candidate;
+                        break;
+                    }
+                }
+            }
+            if (entry) _nearHits++;
+        } else {
+            entry = nil;
+        }
+        
+        if (entry == nil) {
+            _misses++;
+            return nil;
+        }
+        
+        [self detachEntry:entry];
+        [self attachEntry:entry];
+        return [[entry->result retain] autorelease];
+    }
+}
+
+- (void)setResult:(NSDictionary*)result forSignature:(BKTokensSignature)signature inPools:(NSArray*)poolNames
+{
+    @synchronized(self) {
+        if (_capacity == 0) return;
+        
+        NSNumber *key = [NSNumber numberWithUnsignedLongLong:signature.hash];
+        BKResultCacheEntry *entry = [_entries objectForKey:key];
+        if (entry) [self removeEntry:entry];
+        if ([_entries count] >= _capacity) [self removeEntry:_leastRecent];
+        
+        entry = [[BKResultCacheEntry alloc] init];
+        entry->key = [key retain];
+        entry->simHash = signature.simHash;
+        entry->poolNames = poolNames ? [[NSSet alloc] initWithArray:poolNames] : nil;
+        entry->result = [result copy];
+        
+        [_entries setObject:entry forKey:key];
+        [self attachEntry:entry];
+        [self indexEntry:entry];
+        [entry release];
+    }
+}
+
+#pragma mark -
+#pragma mark Invalidation Methods
+- (void)removeResultsForPoolNamed:(NSString*)poolName
+{
+    @synchronized(self) {
+        BKResultCacheEntry *entry = _mostRecent;
+        while (entry) {
+            BKResultCacheEntry *next = entry->next;
+            if (entry->poolNames == nil || [entry->poolNames containsObject:poolName]) {
+                [self removeEntry:entry];
+            }
+            entry = next;
+        }
+    }
+}
+
+- (void)removeAllResults
+{
+    @synchronized(self) {
+        _mostRecent = nil;
+        _leastRecent = nil;
+        [_bands removeAllObjects];
+        [_entries removeAllObjects];
+    }
+}
+
+#pragma mark -
+#pragma mark Printing Methods
+- (float)hitRate
+{
+    @synchronized(self) {
+        NSUInteger lookups = _hits + _nearHits + _misses;
+        if (lookups == 0) return 0.f;
+        return (float)(_hits + _nearHits) / (float)lookups;
+    }
+}
+
+- (void)printInformations
+{
+    @synchronized(self) {
+        NSLog(@"Result Cache Informations:");
+        NSLog(@"        Number of results: %llu / %llu", 
+              (unsigned long long)[_entries count], (unsigned long long)_capacity);
+        NSLog(@"  Near-duplicate distance: %llu", (unsigned long long)_maximumDistance);
+        NSLog(@"     Hits / near / misses: %llu / %llu / %llu", (unsigned long long)_hits,
+              (unsigned long long)_nearHits, (unsigned long long)_misses);
+        NSLog(@"                 Hit rate: %.2f%%", [self hitRate] * 100.f);
+    }
+}
+
+#pragma mark -
+#pragma mark Private Methods
+- (void)detachEntry:(BKResultCacheEntry*)entry
+{
+    if (entry->previous) entry->previous->next = entry->next;
+    else _mostRecent = entry->next;
+    if (entry->next) entry->next->previous = entry->previous;
+    else _leastRecent = entry->previous;
+    
+    entry->previous = nil;
+    entry->next = nil;
+}
+
+- (void)attachEntry:(BKResultCacheEntry*)entry
+{
+    entry->next = _mostRecent;
+    if (_mostRecent) _mostRecent->previous = entry;
+    _mostRecent = entry;
+    if (_leastRecent == nil) _leastRecent = entry;
+}
+
+- (void)removeEntry:(BKResultCacheEntry*)entry
+{
+    NSNumber *key = [[entry->key retain] autorelease];
+    [self detachEntry:entry];
+    [self unindexEntry:entry];
+    [_entries removeObjectForKey:key];
+}
+
+- (void)indexEntry:(BKResultCacheEntry*)entry
+{
+    if (_maximumDistance == 0) return;
+    
+    NSUInteger bandsCount = BKBandsCount(_maximumDistance);
+    for (NSUInteger band = 0; band < bandsCount; band++) {
+        NSNumber *bandKey = BKBandKey(entry->simHash, band, bandsCount);
+        NSMutableArray *bucket = [_bands objectForKey:bandKey];
+        if (bucket == nil) {
+            bucket = [NSMutableArray array];
+            [_bands setObject:bucket forKey:bandKey];
+        }
+        [bucket addObject:entry];
+    }
+}
+
+- (void)unindexEntry:(BKResultCacheEntry*)entry
+{
+    if (_maximumDistance == 0) return;
+    
+    NSUInteger bandsCount = BKBandsCount(_maximumDistance);
+    for (NSUInteger band = 0; band < bandsCount; band++) {
+        NSNumber *bandKey = BKBandKey(entry->simHash, band, bandsCount);
+        NSMutableArray *bucket = [_bands objectForKey:bandKey];
+        [bucket removeObjectIdenticalTo:entry];
+        if ([bucket count] == 0) [_bands removeObjectForKey:bandKey];
+    }
+}
+
+@end
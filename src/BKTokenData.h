@@ -44,6 +44,7 @@
 @interface BKTokenData : NSObject <NSCoding> {
     NSUInteger count;
     float probability;
+    NSUInteger generation;
 }
 
 
@@ -55,6 +56,8 @@
 @property (readwrite, assign) NSUInteger count;
 /** Probability associated with a token in a pool */
 @property (readwrite, assign) float probability;
+/** Generation of the classifier when @c count was last changed */
+@property (readwrite, assign) NSUInteger generation;
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -83,6 +86,17 @@
 - (id)initWithCount:(NSUInteger)aCount;
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+/// @name Counting
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/** Increase @c count by 1 in place.
+ 
+ The @c probability is reset to 0 since it is no longer accurate.
+ */
+- (void)increaseCount;
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 /// @name Comparing token data
 //////////////////////////////////////////////////////////////////////////////////////////
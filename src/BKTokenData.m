@@ -42,6 +42,7 @@
 
 @synthesize count;
 @synthesize probability;
+@synthesize generation;
 
 - (id)initWithCount:(NSUInteger)aCount
 {
@@ -57,6 +58,14 @@
     return [[[BKTokenData alloc] initWithCount:aCount] autorelease];
 }
 
+#pragma mark -
+#pragma mark Counting Methods
+- (void)increaseCount
+{
+    count++;
+    probability = 0.f;
+}
+
 #pragma mark -
 #pragma mark NSCoding Methods
 - (id)initWithCoder:(NSCoder*)coder
@@ -65,6 +74,7 @@
     if (self) {
         count = [coder decodeIntegerForKey:@"Count"];
         probability = [coder decodeFloatForKey:@"Probability"];
+        generation = [coder decodeIntegerForKey:@"Generation"];
     }
     return self;
 }
@@ -73,6 +83,7 @@
 {
     [coder encodeInteger:count forKey:@"Count"];
     [coder encodeFloat:probability forKey:@"Probability"];
+    if (generation > 0) [coder encodeInteger:generation forKey:@"Generation"];
 }
 
 #pragma mark -
@@ -101,7 +112,8 @@
 #pragma mark Printing Methods
 - (NSString*)description
 {
-    return [NSString stringWithFormat:@"{count: %llu, probability: %f}", count, probability];
+    return [NSString stringWithFormat:@"{count: %llu, probability: %f, generation: %llu}", 
+            count, probability, generation];
 }
 
 @end
@@ -35,8 +35,13 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import <BayesianKit/BKBloomFilter.h>
 #import <BayesianKit/BKClassifier.h>
+#import <BayesianKit/BKCompactModel.h>
+#import <BayesianKit/BKCorpus.h>
 #import <BayesianKit/BKDataPool.h>
+#import <BayesianKit/BKFrozenModel.h>
+#import <BayesianKit/BKResultCache.h>
 #import <BayesianKit/BKTokenData.h>
 #import <BayesianKit/BKTokenizer.h>
 #import <BayesianKit/BKTokenizing.h>
\ No newline at end of file
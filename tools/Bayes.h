@@ -43,10 +43,12 @@
     NSString *filepath;
     BKClassifier *classifier;
     BOOL saveWhenExiting;
+    NSArray *guessPools;
 }
 
 @property (readwrite, retain) NSString *filepath;
 @property (readwrite, assign) BOOL saveWhenExiting;
+@property (readwrite, retain) NSArray *guessPools;
 
 - (void)processArguments:(NSArray*)arguments;
 - (NSArray*)extractValuesInArray:(NSArray*)arguments fromIndex:(NSUInteger)idx;
@@ -61,5 +63,12 @@
 - (void)guessOn:(NSArray*)paths;
 - (void)trainOn:(NSArray*)paths withPoolNamed:(NSString*)poolName;
 - (void)stripToLevel:(NSUInteger)level;
+- (void)compactWithQuantizationBits:(NSUInteger)bits;
+- (void)freeze;
+- (void)evaluateQuantizationBits:(NSUInteger)bits onFiles:(NSArray*)paths;
+- (void)streamRecordsWithMode:(NSString*)mode;
+- (void)exportDeltaSinceGeneration:(NSUInteger)baseGeneration toFile:(NSString*)path;
+- (void)applyDeltaFromFile:(NSString*)path;
+- (void)pruneChangesBeforeGeneration:(NSUInteger)baseGeneration;
 
 @end
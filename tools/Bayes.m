@@ -36,6 +36,7 @@
  */
 
 #import "Bayes.h"
+#import "Records.h"
 #import "Utils.h"
 
 #ifdef ARGUMENT_IS
@@ -47,6 +48,7 @@
 
 @synthesize filepath;
 @synthesize saveWhenExiting;
+@synthesize guessPools;
 
 - (id)init
 {
@@ -60,6 +62,7 @@
 {
     [classifier release];
     [filepath release];
+    [guessPools release];
     [super dealloc];
 }
 
@@ -90,6 +93,11 @@
         if ([argument isEqual:@"-s"] || [argument isEqual:@"--save"]) {
             [self setSaveWhenExiting:YES];
         }
+        else if ([argument isEqual:@"-p"] || [argument isEqual:@"--pools"]) {
+            if (i+1 >= [arguments count]) [self showInvalidNumberOfArgumentsFor:@"-p/--pools"];
+            [self setGuessPools:[[arguments objectAtIndex:i+1] componentsSeparatedByString:@","]];
+            i++;
+        }
         else {
             [leftOver addObject:argument];
         }
@@ -125,6 +133,43 @@
             [self stripToLevel:[[leftOver objectAtIndex:i+1] integerValue]];
             i += 1;
         }
+        else if ([argument isEqual:@"-c"] || [argument isEqual:@"--compact"]) {
+            if (i+1 >= [leftOver count]) [self showInvalidNumberOfArgumentsFor:@"-c/--compact"];
+            [self compactWithQuantizationBits:[[leftOver objectAtIndex:i+1] integerValue]];
+            i += 1;
+        }
+        else if ([argument isEqual:@"-z"] || [argument isEqual:@"--freeze"]) {
+            [self freeze];
+        }
+        else if ([argument isEqual:@"-i"] || [argument isEqual:@"--stdin"]) {
+            if (i+1 >= [leftOver count]) [self showInvalidNumberOfArgumentsFor:@"-i/--stdin"];
+            [self streamRecordsWithMode:[leftOver objectAtIndex:i+1]];
+            i += 1;
+        }
+        else if ([argument isEqual:@"-e"] || [argument isEqual:@"--evaluate"]) {
+            NSArray *files = [self extractValuesInArray:leftOver fromIndex:i+2];
+            if (i+2 >= [leftOver count] || [files count] == 0) 
+                [self showInvalidNumberOfArgumentsFor:@"-e/--evaluate"];
+            else
+                [self evaluateQuantizationBits:[[leftOver objectAtIndex:i+1] integerValue] onFiles:files];
+            i += ([files count] + 1);
+        }
+        else if ([argument isEqual:@"-x"] || [argument isEqual:@"--export-delta"]) {
+            if (i+2 >= [leftOver count]) [self showInvalidNumberOfArgumentsFor:@"-x/--export-delta"];
+            [self exportDeltaSinceGeneration:[[leftOver objectAtIndex:i+1] integerValue] 
+                                      toFile:[leftOver objectAtIndex:i+2]];
+            i += 2;
+        }
+        else if ([argument isEqual:@"-a"] || [argument isEqual:@"--apply-delta"]) {
+            if (i+1 >= [leftOver count]) [self showInvalidNumberOfArgumentsFor:@"-a/--apply-delta"];
+            [self applyDeltaFromFile:[leftOver objectAtIndex:i+1]];
+            i += 1;
+        }
+        else if ([argument isEqual:@"-P"] || [argument isEqual:@"--prune"]) {
+            if (i+1 >= [leftOver count]) [self showInvalidNumberOfArgumentsFor:@"-P/--prune"];
+            [self pruneChangesBeforeGeneration:[[leftOver objectAtIndex:i+1] integerValue]];
+            i += 1;
+        }
     }
     
     [self terminateWell:YES];
@@ -168,16 +213,30 @@
 - (void)showHelp
 {
     PrintOut(@"Usage:\n" 
-             "  bayes [-vh] [-sf] [-tgrd]\n"
+             "  bayes [-vh] [-sfp] [-tgirdczexaP]\n"
              "     -h/--help               What is recursion ?\n"
              "     -v/--version            Display the actual version number.\n"
              "\n"
              "     -f/--file <path>        Save/Load classifier training to/from a file.\n"
              "     -s/--save               Save the changes in -f file before exiting.\n"
+             "     -p/--pools <a,b,c>      Only guess against the listed categories.\n"
              "\n"
              "     -t/--train <cat> <path> Uses path as training data for a category.\n"
              "     -g/--guess <path>       Guess to which category path is belonging.\n"
+             "     -i/--stdin <train|guess>\n"
+             "                             Stream NDJSON or TSV records from the standard input,\n"
+             "                             label<tab>text to train and id<tab>text to guess.\n"
              "     -r/--strip <level>      Remove any token with a total count lower than level.\n"
+             "     -c/--compact <bits>     Turn the classifier into a read-only compact model,\n"
+             "                             probabilities being quantized on 8 or 16 bits.\n"
+             "     -z/--freeze             Turn the classifier into a read-only frozen model,\n"
+             "                             tokens being looked up with a perfect hash.\n"
+             "     -e/--evaluate <bits> <path>\n"
+             "                             Compare a compact model with the full precision one.\n"
+             "     -x/--export-delta <generation> <path>\n"
+             "                             Write the changes made since a saved generation to path.\n"
+             "     -a/--apply-delta <path> Apply a delta written by -x, use -s to keep the result.\n"
+             "     -P/--prune <generation> Forget the checkpoints and removals older than generation.\n"
              "     -d/--dump               Print out the whole content of the classifier."
              );
 }
@@ -216,7 +275,8 @@
 - (void)guessOn:(NSArray*)paths
 {
     for (NSString *path in paths) {
-        NSDictionary *results = [classifier guessWithFile:path];
+        NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
+        NSDictionary *results = [classifier guessWithFile:path inPools:guessPools];
         NSString *maxKey = _(@"Nothing");
         float maxValue = -1.f;
         
@@ -233,19 +293,224 @@
         }
         
         PrintOut(@"%@ : %@ (%02i%%)", path, maxKey, (int)(maxValue*100.f));
+        [autoreleasePool drain];
     }
 }
 
 - (void)trainOn:(NSArray*)paths withPoolNamed:(NSString*)poolName
 {
-    for (NSString *path in paths) {
-        [classifier trainWithFile:path forPoolNamed:poolName];
+    @try {
+        [classifier trainWithFiles:paths forPoolNamed:poolName];
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
     }
 }
 
 - (void)stripToLevel:(NSUInteger)level
 {
-    [classifier stripToLevel:level];
+    @try {
+        [classifier stripToLevel:level];
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
+}
+
+- (void)compactWithQuantizationBits:(NSUInteger)bits
+{
+    @try {
+        [classifier compactWithQuantizationBits:bits];
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
+}
+
+- (void)freeze
+{
+    @try {
+        [classifier freeze];
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
+}
+
+- (void)streamRecordsWithMode:(NSString*)mode
+{
+    BOOL training = [mode isEqual:@"train"];
+    if (!training && ![mode isEqual:@"guess"]) {
+        PrintOut(@"Error - Unknown mode %@ for -i/--stdin, use train or guess", mode);
+        [self terminateWell:NO];
+    }
+    
+    RecordReader *reader = [[RecordReader alloc] initWithFileDescriptor:STDIN_FILENO];
+    RecordWriter *writer = [[RecordWriter alloc] initWithFile:stdout];
+    NSString *keyName = training ? @"label" : @"id";
+    NSUInteger lineNumber = 0;
+    const char *line;
+    NSUInteger length;
+    
+    while ([reader nextLine:&line length:&length]) {
+        NSAutoreleasePool *autoreleasePool = [[NSAutoreleasePool alloc] init];
+        NSString *key, *rawKey, *text;
+        BOOL isJSON;
+        lineNumber++;
+        
+        if (length == 0) {
+            // Blank lines are simply skipped
+        }
+        else if (!ParseRecord(line, length, keyName, &key, &rawKey, &text, &isJSON) || (training && key == nil)) {
+            fprintf(stderr, "Error - Invalid record on line %llu\n", (unsigned long long)lineNumber);
+            
+            // Guesses keep one output record per input record
+            if (!training) {
+                if (key == nil) key = [NSString stringWithFormat:@"%llu", (unsigned long long)lineNumber];
+                if (isJSON) {
+                    [writer appendString:@"{\"id\":"];
+                    if (rawKey) [writer appendString:rawKey];
+                    else [writer appendJSONString:key];
+                    [writer appendString:@",\"error\":\"Invalid record\"}"];
+                } else {
+                    [writer appendString:key];
+                    [writer appendString:@"\terror=Invalid record"];
+                }
+                [writer endRecord];
+            }
+        }
+        else if (training) {
+            @try {
+                [classifier trainWithString:text forPoolNamed:key];
+            }
+            @catch (NSException *e) {
+                PrintOut(@"Error - %@", [e reason]);
+                [self terminateWell:NO];
+            }
+        }
+        else {
+            if (key == nil) key = [NSString stringWithFormat:@"%llu", (unsigned long long)lineNumber];
+            NSDictionary *results = [classifier guessWithString:text inPools:guessPools];
+            NSArray *poolNames = [[results allKeys] sortedArrayUsingSelector:@selector(compare:)];
+            NSString *maxKey = nil;
+            float maxValue = -1.f;
+            
+            for (NSString *poolName in poolNames) {
+                float value = [[results objectForKey:poolName] floatValue];
+                if (value > maxValue) {
+                    maxValue = value;
+                    maxKey = poolName;
+                }
+            }
+            
+            if (isJSON) {
+                [writer appendString:@"{\"id\":"];
+                if (rawKey) [writer appendString:rawKey];
+                else [writer appendJSONString:key];
+                [writer appendString:@",\"pool\":"];
+                if (maxKey) [writer appendJSONString:maxKey];
+                else [writer appendString:@"null"];
+                [writer appendString:@",\"scores\":{"];
+                for (NSString *poolName in poolNames) {
+                    if (poolName != [poolNames objectAtIndex:0]) [writer appendString:@","];
+                    [writer appendJSONString:poolName];
+                    [writer appendString:@":"];
+                    [writer appendFloat:[[results objectForKey:poolName] floatValue]];
+                }
+                [writer appendString:@"}}"];
+            } else {
+                [writer appendString:key];
+                [writer appendString:@"\t"];
+                if (maxKey) [writer appendString:maxKey];
+                for (NSString *poolName in poolNames) {
+                    [writer appendString:@"\t"];
+                    [writer appendString:poolName];
+                    [writer appendString:@"="];
+                    [writer appendFloat:[[results objectForKey:poolName] floatValue]];
+                }
+            }
+            [writer endRecord];
+        }
+        [autoreleasePool drain];
+    }
+    
+    [writer flush];
+    [writer release];
+    [reader release];
+}
+
+- (void)evaluateQuantizationBits:(NSUInteger)bits onFiles:(NSArray*)paths
+{
+    NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:classifier];
+    BKClassifier *compacted = [NSKeyedUnarchiver unarchiveObjectWithData:archive];
+    
+    @try {
+        [compacted compactWithQuantizationBits:bits];
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
+    
+    NSDictionary *report = [compacted compareWithClassifier:classifier onFiles:paths];
+    PrintOut(@"%@-bit compact model against full precision:", [NSNumber numberWithUnsignedInteger:bits]);
+    PrintOut(@"  Documents           : %@", [report objectForKey:BKComparisonDocumentsKey]);
+    PrintOut(@"  Same guess          : %.2f%%", [[report objectForKey:BKComparisonAgreementKey] floatValue] * 100.f);
+    PrintOut(@"  Mean score delta    : %f", [[report objectForKey:BKComparisonMeanDeltaKey] floatValue]);
+    PrintOut(@"  Max score delta     : %f", [[report objectForKey:BKComparisonMaxDeltaKey] floatValue]);
+}
+
+- (void)exportDeltaSinceGeneration:(NSUInteger)baseGeneration toFile:(NSString*)path
+{
+    @try {
+        NSData *delta = [classifier deltaSinceGeneration:baseGeneration];
+        if (![delta writeToFile:path atomically:YES]) {
+            PrintOut(@"Error - Unable to write the delta to %@", path);
+            [self terminateWell:NO];
+        }
+        PrintOut(@"%@ : generation %@ to %@ (%@ bytes)", path, 
+                 [NSNumber numberWithUnsignedInteger:baseGeneration], 
+                 [NSNumber numberWithUnsignedInteger:[classifier generation]], 
+                 [NSNumber numberWithUnsignedInteger:[delta length]]);
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
+}
+
+- (void)pruneChangesBeforeGeneration:(NSUInteger)baseGeneration
+{
+    @try {
+        [classifier discardChangesBeforeGeneration:baseGeneration];
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
+}
+
+- (void)applyDeltaFromFile:(NSString*)path
+{
+    NSData *delta = [NSData dataWithContentsOfFile:path];
+    if (delta == nil) {
+        PrintOut(@"Error - Unable to read the delta from %@", path);
+        [self terminateWell:NO];
+    }
+    
+    @try {
+        [classifier applyDelta:delta];
+        PrintOut(@"%@ : now at generation %@", path, 
+                 [NSNumber numberWithUnsignedInteger:[classifier generation]]);
+    }
+    @catch (NSException *e) {
+        PrintOut(@"Error - %@", [e reason]);
+        [self terminateWell:NO];
+    }
 }
 
 @end
@@ -0,0 +1,171 @@
+//
+// ProbabilityCheck.c
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Checks that the column computation of the probabilities rebuild gives, bit 
+// for bit, the probabilities of the per token computation it replaced, and the 
+// same significance cut. The "Check Probabilities" target, on which the 
+// framework depends, builds and runs it whenever it or BKProbabilities.h 
+// changes, failing the build on any mismatch. By hand, on an SSE2 machine, 
+// from the repository's root:
+//
+//     cc -O2 -msse2 -Isrc tools/ProbabilityCheck.c -o ProbabilityCheck -lm && ./ProbabilityCheck
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BKProbabilities.h"
+
+#ifndef __SSE2__
+#error "Build with SSE2 enabled, the scalar path is the reference itself"
+#endif
+
+#define CheckMaxColumn 64
+#define CheckSmallCount 200
+
+static const unsigned long CheckSmallTotals[] = {0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 12, 15, 20, 30, 100, 333, 1000};
+
+static unsigned long mismatches = 0;
+static unsigned long compared = 0;
+
+// The per token computation, from integer counts, as it was before columns
+static float ReferenceProbability(unsigned long poolCount, unsigned long corpusCount, 
+                                  unsigned long poolTotalCount, unsigned long corpusTotalCount, int *significant)
+{
+    unsigned long deltaCount = corpusCount - poolCount;
+    unsigned long deltaTotalCount = corpusTotalCount - poolTotalCount;
+    if (deltaTotalCount < 1) deltaTotalCount = 1;
+    
+    float goodMetric;
+    if (poolTotalCount == 0) {
+        goodMetric = 1.f;
+    } else {
+        goodMetric = (float)deltaCount/(float)poolTotalCount;
+        if (goodMetric > 1.f) goodMetric = 1.f;
+    }
+    float badMetric = (float)poolCount/(float)deltaTotalCount;
+    if (badMetric > 1.f) badMetric = 1.f;
+    float f = badMetric / (goodMetric + badMetric);
+    
+    *significant = (fabs(f - 0.5f) >= 0.1);
+    return f;
+}
+
+static void CheckColumn(const unsigned long *poolCounts, const unsigned long *corpusCounts, size_t count,
+                        unsigned long poolTotalCount, unsigned long corpusTotalCount)
+{
+    static float poolColumn[CheckSmallCount * CheckSmallCount];
+    static float deltaColumn[CheckSmallCount * CheckSmallCount];
+    static float probabilities[CheckSmallCount * CheckSmallCount];
+    unsigned long deltaTotalCount = corpusTotalCount - poolTotalCount;
+    if (deltaTotalCount < 1) deltaTotalCount = 1;
+    
+    for (size_t idx = 0; idx < count; idx++) {
+        poolColumn[idx] = (float)poolCounts[idx];
+        deltaColumn[idx] = (float)(corpusCounts[idx] - poolCounts[idx]);
+    }
+    BKComputeProbabilities(poolColumn, deltaColumn, count, (float)poolTotalCount, 
+                           (float)deltaTotalCount, poolTotalCount == 0, probabilities);
+    
+    for (size_t idx = 0; idx < count; idx++) {
+        int significant;
+        float expected = ReferenceProbability(poolCounts[idx], corpusCounts[idx], 
+                                              poolTotalCount, corpusTotalCount, &significant);
+        if (significant ? memcmp(&expected, &probabilities[idx], sizeof(float)) != 0 
+                        : probabilities[idx] != BKNotSignificant) {
+            if (mismatches < 10) {
+                fprintf(stderr, "Mismatch: pool %lu/%lu, corpus %lu/%lu: %.9g instead of %.9g\n", 
+                        poolCounts[idx], poolTotalCount, corpusCounts[idx], corpusTotalCount, 
+                        probabilities[idx], significant ? expected : BKNotSignificant);
+            }
+            mismatches++;
+        }
+        compared++;
+    }
+}
+
+// Columns of random lengths, so that both the SSE2 and the remainder loops run
+static void CheckRandomColumns(unsigned int trials)
+{
+    unsigned long poolCounts[CheckMaxColumn], corpusCounts[CheckMaxColumn];
+    
+    srand(7);
+    for (unsigned int trial = 0; trial < trials; trial++) {
+        size_t count = (size_t)(rand() % CheckMaxColumn);
+        unsigned long poolTotalCount = (rand() % 4 == 0) ? 0 : (unsigned long)(rand() % 1000000);
+        unsigned long corpusTotalCount = poolTotalCount + ((rand() % 3 == 0) ? 0 : (unsigned long)(rand() % 5000000));
+        
+        for (size_t idx = 0; idx < count; idx++) {
+            poolCounts[idx] = (rand() % 5 == 0) ? 0 : (unsigned long)(rand() % ((rand() % 2) ? 10 : 100000));
+            corpusCounts[idx] = poolCounts[idx] + ((rand() % 3 == 0) ? 0 : (unsigned long)(rand() % 100000));
+        }
+        CheckColumn(poolCounts, corpusCounts, count, poolTotalCount, corpusTotalCount);
+    }
+}
+
+// Every small pool and corpus count against small totals, where the metrics 
+// saturate and probabilities land next to the significance cut
+static void CheckSmallCounts(void)
+{
+    static unsigned long poolCounts[CheckSmallCount * CheckSmallCount];
+    static unsigned long corpusCounts[CheckSmallCount * CheckSmallCount];
+    size_t totalsCount = sizeof(CheckSmallTotals) / sizeof(CheckSmallTotals[0]);
+    size_t count = 0;
+    
+    for (unsigned long poolCount = 0; poolCount < CheckSmallCount; poolCount++) {
+        for (unsigned long deltaCount = 0; deltaCount < CheckSmallCount; deltaCount++) {
+            poolCounts[count] = poolCount;
+            corpusCounts[count] = poolCount + deltaCount;
+            count++;
+        }
+    }
+    for (size_t poolIdx = 0; poolIdx < totalsCount; poolIdx++) {
+        for (size_t deltaIdx = 0; deltaIdx < totalsCount; deltaIdx++) {
+            unsigned long poolTotalCount = CheckSmallTotals[poolIdx];
+            CheckColumn(poolCounts, corpusCounts, count, poolTotalCount, poolTotalCount + CheckSmallTotals[deltaIdx]);
+        }
+    }
+}
+
+int main(void)
+{
+    CheckRandomColumns(20000);
+    CheckSmallCounts();
+    
+    printf("%lu probabilities compared, %lu mismatches\n", compared, mismatches);
+    return (mismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,87 @@
+//
+// Records.h
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Reads lines from a file descriptor with large buffered reads.
+ 
+ Lines returned point directly into the buffer and are only valid until the 
+ next call to -nextLine:length:.
+ */
+@interface RecordReader : NSObject {
+    int fileDescriptor;
+    char *buffer;
+    NSUInteger capacity;
+    NSUInteger start;
+    NSUInteger end;
+    BOOL endOfFile;
+}
+
+- (id)initWithFileDescriptor:(int)aFileDescriptor;
+- (BOOL)nextLine:(const char**)line length:(NSUInteger*)length;
+
+@end
+
+
+/** Buffers records and writes them, in order, by batches. */
+@interface RecordWriter : NSObject {
+    FILE *file;
+    NSMutableData *buffer;
+    NSUInteger pendingRecords;
+}
+
+- (id)initWithFile:(FILE*)aFile;
+- (void)appendString:(NSString*)string;
+- (void)appendJSONString:(NSString*)string;
+- (void)appendFloat:(float)value;
+- (void)endRecord;
+- (void)flush;
+
+@end
+
+
+/** Splits a NDJSON or TSV line into a key and a text.
+ 
+ A line starting with '{' is read as a flat JSON object, the key being the value
+ of keyName and the text the value of "text". rawKey is then the JSON text of 
+ the key's value as found on the line, so that null or numbers can be written 
+ back unchanged; values other than strings must be JSON literals or numbers, 
+ and the text must be a string. Any other line is read as TSV, the key being everything before 
+ the first tab and the text everything after, and rawKey is nil.
+ */
+BOOL ParseRecord(const char *line, NSUInteger length, NSString *keyName, 
+                 NSString **key, NSString **rawKey, NSString **text, BOOL *isJSON);
@@ -0,0 +1,379 @@
+//
+// Records.m
+// Licensed under the terms of the BSD License, as specified below.
+//
+
+/*
+ Copyright (c) 2010, Samuel Mendes
+ 
+ All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ 
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ 
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ 
+ * Neither the name of ᐱ nor the names of its
+ contributors may be used to endorse or promote products derived
+ from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "Records.h"
+#import <unistd.h>
+#import <errno.h>
+
+#define RecordReaderCapacity (1 << 20)
+#define RecordWriterCapacity (1 << 18)
+#define RecordWriterBatchSize 1024
+
+
+@implementation RecordReader
+
+- (id)initWithFileDescriptor:(int)aFileDescriptor
+{
+    self = [super init];
+    if (self) {
+        fileDescriptor = aFileDescriptor;
+        capacity = RecordReaderCapacity;
+        buffer = malloc(capacity);
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    free(buffer);
+    [super dealloc];
+}
+
+- (BOOL)nextLine:(const char**)line length:(NSUInteger*)length
+{
+    while (YES) {
+        char *newline = memchr(buffer + start, '\n', end - start);
+        
+        if (newline || (endOfFile && start < end)) {
+            NSUInteger lineEnd = newline ? (NSUInteger)(newline - buffer) : end;
+            *line = buffer + start;
+            *length = lineEnd - start;
+            if (*length > 0 && (*line)[*length - 1] == '\r') (*length)--;
+            start = newline ? lineEnd + 1 : end;
+            return YES;
+        }
+        if (endOfFile) return NO;
+        
+        // Keep the beginning of the current line and refill after it
+        memmove(buffer, buffer + start, end - start);
+        end -= start;
+        start = 0;
+        if (end == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+        }
+        
+        ssize_t count = read(fileDescriptor, buffer + end, capacity - end);
+        if (count > 0) {
+            end += count;
+        } else if (count < 0 && errno == EINTR) {
+            continue;
+        } else {
+            endOfFile = YES;
+        }
+    }
+}
+
+@end
+
+
+@implementation RecordWriter
+
+- (id)initWithFile:(FILE*)aFile
+{
+    self = [super init];
+    if (self) {
+        file = aFile;
+        buffer = [[NSMutableData alloc] initWithCapacity:RecordWriterCapacity];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self flush];
+    [buffer release];
+    [super dealloc];
+}
+
+// Texts may hold NUL characters, lengths are never taken with strlen
+- (void)appendString:(NSString*)string
+{
+    [buffer appendBytes:[string UTF8String] length:[string lengthOfBytesUsingEncoding:NSUTF8StringEncoding]];
+}
+
+- (void)appendJSONString:(NSString*)string
+{
+    const char *bytes = [string UTF8String];
+    const char *end = bytes + [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    const char *run = bytes;
+    
+    [buffer appendBytes:"\"" length:1];
+    for (const char *cursor = bytes; cursor < end; cursor++) {
+        unsigned char c = (unsigned char)*cursor;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        
+        char escape[7];
+        [buffer appendBytes:run length:cursor - run];
+        switch (c) {
+            case '"':  strcpy(escape, "\\\""); break;
+            case '\\': strcpy(escape, "\\\\"); break;
+            case '\n': strcpy(escape, "\\n"); break;
+            case '\r': strcpy(escape, "\\r"); break;
+            case '\t': strcpy(escape, "\\t"); break;
+            default:   snprintf(escape, sizeof(escape), "\\u%04x", c); break;
+        }
+        [buffer appendBytes:escape length:strlen(escape)];
+        run = cursor + 1;
+    }
+    [buffer appendBytes:run length:end - run];
+    [buffer appendBytes:"\"" length:1];
+}
+
+- (void)appendFloat:(float)value
+{
+    char bytes[32];
+    int length = snprintf(bytes, sizeof(bytes), "%.6f", value);
+    [buffer appendBytes:bytes length:length];
+}
+
+- (void)endRecord
+{
+    [buffer appendBytes:"\n" length:1];
+    pendingRecords++;
+    
+    if ([buffer length] >= RecordWriterCapacity || pendingRecords >= RecordWriterBatchSize) {
+        [self flush];
+    }
+}
+
+- (void)flush
+{
+    if ([buffer length] > 0) {
+        fwrite([buffer bytes], 1, [buffer length], file);
+        fflush(file);
+        [buffer setLength:0];
+    }
+    pendingRecords = 0;
+}
+
+@end
+
+
+#pragma mark -
+#pragma mark Parsing Functions
+static const char *SkipSpaces(const char *cursor, const char *end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) cursor++;
+    return cursor;
+}
+
+static void AppendCodePoint(NSMutableData *data, uint32_t codePoint)
+{
+    uint8_t bytes[4];
+    NSUInteger length;
+    
+    if (codePoint < 0x80) {
+        bytes[0] = codePoint;
+        length = 1;
+    } else if (codePoint < 0x800) {
+        bytes[0] = 0xc0 | (codePoint >> 6);
+        bytes[1] = 0x80 | (codePoint & 0x3f);
+        length = 2;
+    } else if (codePoint < 0x10000) {
+        bytes[0] = 0xe0 | (codePoint >> 12);
+        bytes[1] = 0x80 | ((codePoint >> 6) & 0x3f);
+        bytes[2] = 0x80 | (codePoint & 0x3f);
+        length = 3;
+    } else {
+        bytes[0] = 0xf0 | (codePoint >> 18);
+        bytes[1] = 0x80 | ((codePoint >> 12) & 0x3f);
+        bytes[2] = 0x80 | ((codePoint >> 6) & 0x3f);
+        bytes[3] = 0x80 | (codePoint & 0x3f);
+        length = 4;
+    }
+    [data appendBytes:bytes length:length];
+}
+
+static BOOL ParseHexadecimal(const char *cursor, const char *end, uint32_t *value)
+{
+    if (end - cursor < 4) return NO;
+    
+    uint32_t result = 0;
+    for (int idx = 0; idx < 4; idx++) {
+        char c = cursor[idx];
+        result <<= 4;
+        if (c >= '0' && c <= '9') result |= c - '0';
+        else if (c >= 'a' && c <= 'f') result |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') result |= c - 'A' + 10;
+        else return NO;
+    }
+    *value = result;
+    return YES;
+}
+
+// The cursor must be on the opening quote, it is left after the closing one
+static NSString *ParseJSONString(const char **cursor, const char *end)
+{
+    const char *p = *cursor + 1;
+    NSMutableData *bytes = [NSMutableData data];
+    
+    while (p < end && *p != '"') {
+        const char *run = p;
+        while (p < end && *p != '"' && *p != '\\') p++;
+        [bytes appendBytes:run length:p - run];
+        if (p >= end || *p == '"') break;
+        
+        if (++p >= end) return nil;
+        char escape = *p++;
+        switch (escape) {
+            case '"': case '\\': case '/': AppendCodePoint(bytes, escape); break;
+            case 'b': AppendCodePoint(bytes, '\b'); break;
+            case 'f': AppendCodePoint(bytes, '\f'); break;
+            case 'n': AppendCodePoint(bytes, '\n'); break;
+            case 'r': AppendCodePoint(bytes, '\r'); break;
+            case 't': AppendCodePoint(bytes, '\t'); break;
+            case 'u': {
+                uint32_t codePoint, low;
+                if (!ParseHexadecimal(p, end, &codePoint)) return nil;
+                p += 4;
+                if (codePoint >= 0xd800 && codePoint < 0xdc00) {
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u') return nil;
+                    if (!ParseHexadecimal(p + 2, end, &low) || low < 0xdc00 || low > 0xdfff) return nil;
+                    p += 6;
+                    codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                }
+                AppendCodePoint(bytes, codePoint);
+                break;
+            }
+            default:
+                return nil;
+        }
+    }
+    if (p >= end) return nil;
+    
+    *cursor = p + 1;
+    return [[[NSString alloc] initWithData:bytes encoding:NSUTF8StringEncoding] autorelease];
+}
+
+// Literals and numbers, following the JSON grammar so that they can be echoed
+static BOOL IsJSONScalar(const char *scalar, const char *end)
+{
+    NSUInteger length = end - scalar;
+    if ((length == 4 && memcmp(scalar, "null", 4) == 0) || 
+        (length == 4 && memcmp(scalar, "true", 4) == 0) || 
+        (length == 5 && memcmp(scalar, "false", 5) == 0)) return YES;
+    
+    const char *p = scalar;
+    if (p < end && *p == '-') p++;
+    if (p >= end || *p < '0' || *p > '9') return NO;
+    if (*p == '0') p++;
+    else while (p < end && *p >= '0' && *p <= '9') p++;
+    
+    if (p < end && *p == '.') {
+        if (++p >= end || *p < '0' || *p > '9') return NO;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p >= end || *p < '0' || *p > '9') return NO;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    return p == end;
+}
+
+static BOOL ParseJSONRecord(const char *line, NSUInteger length, NSString *keyName, 
+                            NSString **key, NSString **rawKey, NSString **text)
+{
+    const char *end = line + length;
+    const char *p = SkipSpaces(line, end) + 1;
+    
+    p = SkipSpaces(p, end);
+    if (p < end && *p == '}') return NO;
+    
+    while (p < end) {
+        if (*p != '"') return NO;
+        NSString *name = ParseJSONString(&p, end);
+        if (name == nil) return NO;
+        
+        p = SkipSpaces(p, end);
+        if (p >= end || *p != ':') return NO;
+        p = SkipSpaces(p + 1, end);
+        if (p >= end || *p == '{' || *p == '[') return NO;
+        
+        NSString *value;
+        const char *valueStart = p;
+        if (*p == '"') {
+            value = ParseJSONString(&p, end);
+        } else {
+            const char *scalar = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t') p++;
+            if (!IsJSONScalar(scalar, p)) return NO;
+            value = [[[NSString alloc] initWithBytes:scalar length:(p - scalar) 
+                                            encoding:NSUTF8StringEncoding] autorelease];
+        }
+        if (value == nil) return NO;
+        
+        if ([name isEqual:keyName]) {
+            *key = value;
+            *rawKey = [[[NSString alloc] initWithBytes:valueStart length:(p - valueStart) 
+                                              encoding:NSUTF8StringEncoding] autorelease];
+        }
+        // A null text is no text, as if it were missing
+        else if ([name isEqual:@"text"]) *text = (*valueStart == '"') ? value : nil;
+        
+        p = SkipSpaces(p, end);
+        if (p >= end) return NO;
+        if (*p == '}') break;
+        if (*p != ',') return NO;
+        p = SkipSpaces(p + 1, end);
+    }
+    
+    return *text != nil;
+}
+
+BOOL ParseRecord(const char *line, NSUInteger length, NSString *keyName, 
+                 NSString **key, NSString **rawKey, NSString **text, BOOL *isJSON)
+{
+    *key = nil;
+    *rawKey = nil;
+    *text = nil;
+    const char *first = SkipSpaces(line, line + length);
+    *isJSON = (first < line + length && *first == '{');
+    
+    if (*isJSON) return ParseJSONRecord(line, length, keyName, key, rawKey, text);
+    
+    const char *tab = memchr(line, '\t', length);
+    if (tab == NULL) return NO;
+    
+    *key = [[[NSString alloc] initWithBytes:line length:(tab - line) 
+                                   encoding:NSUTF8StringEncoding] autorelease];
+    *text = [[[NSString alloc] initWithBytes:(tab + 1) length:(length - (tab - line) - 1) 
+                                    encoding:NSUTF8StringEncoding] autorelease];
+    return (*key != nil && *text != nil);
+}